@@ -1,11 +1,30 @@
 // Int(4 / (1 + x^2)), x in [0, 1]. This integral equals to Pi.
 
+#include "quadrature.hpp"
 #include "time_measurer.hpp"
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <omp.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 using namespace std::chrono;
@@ -14,7 +33,7 @@ using namespace std::chrono;
 
 constexpr uint64_t num_steps = 100'000'000;
 constexpr double step = 1.0 / (double)num_steps;
-constexpr uint32_t num_threads = 4;			// Requested number of threads
+uint32_t num_threads = 4;					// Requested number of threads, varied by --sweep
 
 
 
@@ -35,7 +54,7 @@ double integral_1()
 
 double integral_2()
 {
-	double sum[num_threads];
+	vector<double> sum(num_threads);
 	uint32_t nthreads;
 
 	omp_set_num_threads(num_threads);
@@ -66,7 +85,7 @@ double integral_2()
 double integral_3()
 {
 	constexpr uint32_t pad = 8;				// For 64 bytes L1 cache line
-	double sum[num_threads][pad];
+	vector<array<double, pad>> sum(num_threads);
 	uint32_t nthreads;
 
 	omp_set_num_threads(num_threads);
@@ -145,7 +164,7 @@ double integral_6()			// Best version
 {
 	double sum = 0.0;
 
-	#pragma omp parallel for reduction(+ : sum) schedule(static)
+	#pragma omp parallel for reduction(+ : sum) schedule(static) num_threads(num_threads)
 		for ( uint64_t i = 0; i < num_steps; ++i )
 		{
 			const double x = (i + 0.5) * step;		// In the middle of the rectangle
@@ -157,39 +176,480 @@ double integral_6()			// Best version
 
 
 
-int main()
+// Vectorized kernels: sum of 4/(1+x^2) over steps [first, last), several
+// lanes at once. Compiled with per-function target attributes, so the file
+// builds without -mavx2 and the best one is picked at run time.
+
+using Kernel = double (*)(uint64_t first, uint64_t last);
+
+double kernelScalar(uint64_t first, uint64_t last)
 {
-	double d1, d2, d3, d4, d5, d6;
+	double sum = 0.0;
+	#pragma omp simd reduction(+ : sum)
+		for ( uint64_t i = first; i < last; ++i )
+		{
+			const double x = (i + 0.5) * step;
+			sum += 4.0 / (1.0 + x*x);
+		}
+	return sum;
+}
 
-	START_TIMER("integral_1: ")
-		d1 = integral_1();
-	STOP_TIMER
-	cout << "Intergal_1 is " << d1 << "\n";
+#if defined(__x86_64__)
+double kernelSse2(uint64_t first, uint64_t last)		// 2 lanes, baseline on x86-64
+{
+	const uint64_t n = (last - first) / 2 * 2;
+	const __m128d vstep = _mm_set1_pd(step), one = _mm_set1_pd(1.0), four = _mm_set1_pd(4.0);
+	const __m128d lanes = _mm_set1_pd(2.0);
+	__m128d idx = _mm_setr_pd(first + 0.5, first + 1.5);
+	__m128d acc = _mm_setzero_pd();
+	for ( uint64_t i = 0; i < n; i += 2 )
+	{
+		const __m128d x = _mm_mul_pd(idx, vstep);
+		acc = _mm_add_pd(acc, _mm_div_pd(four, _mm_add_pd(one, _mm_mul_pd(x, x))));
+		idx = _mm_add_pd(idx, lanes);
+	}
+	double part[2];
+	_mm_storeu_pd(part, acc);
+	return part[0] + part[1] + kernelScalar(first + n, last);
+}
 
-	START_TIMER("integral_2: ")
-		d2 = integral_2();
-	STOP_TIMER
-	cout << "Intergal_2 is " << d2 << "\n";
+__attribute__((target("avx2,fma")))
+double kernelAvx2(uint64_t first, uint64_t last)		// 4 lanes
+{
+	const uint64_t n = (last - first) / 4 * 4;
+	const __m256d vstep = _mm256_set1_pd(step), one = _mm256_set1_pd(1.0), four = _mm256_set1_pd(4.0);
+	const __m256d lanes = _mm256_set1_pd(4.0);
+	__m256d idx = _mm256_setr_pd(first + 0.5, first + 1.5, first + 2.5, first + 3.5);
+	__m256d acc = _mm256_setzero_pd();
+	for ( uint64_t i = 0; i < n; i += 4 )
+	{
+		const __m256d x = _mm256_mul_pd(idx, vstep);
+		acc = _mm256_add_pd(acc, _mm256_div_pd(four, _mm256_fmadd_pd(x, x, one)));
+		idx = _mm256_add_pd(idx, lanes);
+	}
+	double part[4];
+	_mm256_storeu_pd(part, acc);
+	return (part[0] + part[1]) + (part[2] + part[3]) + kernelScalar(first + n, last);
+}
 
-	START_TIMER("integral_3: ")
-		d3 = integral_3();
-	STOP_TIMER
-	cout << "Intergal_1 is " << d3 << "\n";
+__attribute__((target("avx512f")))
+double kernelAvx512(uint64_t first, uint64_t last)	// 8 lanes
+{
+	const uint64_t n = (last - first) / 8 * 8;
+	const __m512d vstep = _mm512_set1_pd(step), one = _mm512_set1_pd(1.0), four = _mm512_set1_pd(4.0);
+	const __m512d lanes = _mm512_set1_pd(8.0);
+	__m512d idx = _mm512_add_pd(_mm512_set1_pd(first + 0.5),
+		_mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0));
+	__m512d acc = _mm512_setzero_pd();
+	for ( uint64_t i = 0; i < n; i += 8 )
+	{
+		const __m512d x = _mm512_mul_pd(idx, vstep);
+		acc = _mm512_add_pd(acc, _mm512_div_pd(four, _mm512_fmadd_pd(x, x, one)));
+		idx = _mm512_add_pd(idx, lanes);
+	}
+	double part[8];
+	_mm512_storeu_pd(part, acc);
+	return ((part[0] + part[1]) + (part[2] + part[3])) + ((part[4] + part[5]) + (part[6] + part[7]))
+		+ kernelScalar(first + n, last);
+}
+#endif
+
+Kernel selectKernel(const char*& name)
+{
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports("avx512f") )
+	{
+		name = "AVX-512";
+		return kernelAvx512;
+	}
+	if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") )
+	{
+		name = "AVX2";
+		return kernelAvx2;
+	}
+	name = "SSE2";
+	return kernelSse2;
+#else
+	name = "scalar";
+	return kernelScalar;
+#endif
+}
+
+const char* kernel_name = "";
+const Kernel kernel = selectKernel(kernel_name);
+
+
+
+double integral_7()			// SIMD kernel + OpenMP reduction over contiguous blocks
+{
+	constexpr uint64_t block = 1 << 16;
+	const uint64_t num_blocks = (num_steps + block - 1) / block;
+	double sum = 0.0;
+
+	#pragma omp parallel for reduction(+ : sum) schedule(static) num_threads(num_threads)
+		for ( uint64_t b = 0; b < num_blocks; ++b )
+			sum += kernel(b * block, min(num_steps, (b + 1) * block));
+
+	return (step * sum);
+}
+
+
+
+double integral_8()			// Adaptive Gauss-Kronrod from quadrature.hpp
+{
+	omp_set_num_threads(num_threads);
+	return adaptiveGaussKronrod([](double x){ return 4.0 / (1.0 + x*x); }, 0.0, 1.0, 1e-13).value;
+}
+
+
+
+// Random-access counting iterator for the parallel algorithms. iota_view
+// would do, but its iterator_category is input_iterator_tag, so libstdc++
+// (PSTL) silently falls back to a serial loop for it.
+struct StepIterator
+{
+	using iterator_category = random_access_iterator_tag;
+	using value_type = uint64_t;
+	using difference_type = int64_t;
+	using pointer = const uint64_t*;
+	using reference = uint64_t;
+
+	uint64_t i;
+
+	uint64_t operator*() const { return i; }
+	uint64_t operator[](difference_type n) const { return i + n; }
+	StepIterator& operator++() { ++i; return *this; }
+	StepIterator operator++(int) { return {i++}; }
+	StepIterator& operator--() { --i; return *this; }
+	StepIterator operator--(int) { return {i--}; }
+	StepIterator& operator+=(difference_type n) { i += n; return *this; }
+	StepIterator& operator-=(difference_type n) { i -= n; return *this; }
+	StepIterator operator+(difference_type n) const { return {i + n}; }
+	friend StepIterator operator+(difference_type n, StepIterator it) { return {it.i + n}; }
+	StepIterator operator-(difference_type n) const { return {i - n}; }
+	difference_type operator-(StepIterator other) const { return difference_type(i - other.i); }
+	auto operator<=>(const StepIterator&) const = default;
+};
+
+
+
+// Standard parallel algorithm, no OpenMP. libstdc++ runs it on TBB, which
+// sizes its own thread pool and ignores num_threads.
+double integral_9()
+{
+	const double sum = transform_reduce(execution::par_unseq,
+		StepIterator {0}, StepIterator {num_steps}, 0.0, plus<>(),
+		[](uint64_t i)
+		{
+			const double x = (i + 0.5) * step;
+			return 4.0 / (1.0 + x*x);
+		});
+	return (step * sum);
+}
+
+
+
+double integral_10()		// Plain std::thread, contiguous blocks, padded partial sums
+{
+	struct alignas(64) PaddedSum				// Generalizes the sum[id][pad] trick of integral_3
+	{
+		double value;
+	};
+	vector<PaddedSum> sum(num_threads);
+	vector<thread> threads;
+
+	for ( uint32_t id = 0; id < num_threads; ++id )
+		threads.emplace_back([&sum, id]()
+		{
+			const uint64_t first = num_steps * id / num_threads;
+			const uint64_t last = num_steps * (id + 1) / num_threads;
+			double local = 0.0;					// Register accumulator, vectorizable loop
+			for ( uint64_t i = first; i < last; ++i )
+			{
+				const double x = (i + 0.5) * step;
+				local += 4.0 / (1.0 + x*x);
+			}
+			sum[id].value = local;
+		});
+	for ( auto& th : threads )  th.join();
+
+	double pi = 0.0;
+	for ( const auto& s : sum )
+		pi += s.value * step;
+	return pi;
+}
 
-	START_TIMER("integral_4: ")
-		d4 = integral_4();
-	STOP_TIMER
-	cout << "Intergal_4 is " << d4 << "\n";
 
-	START_TIMER("integral_5: ")
-		d5 = integral_5();
-	STOP_TIMER
-	cout << "Intergal_5 is " << d5 << "\n";
 
-	START_TIMER("integral_6: ")
-		d6 = integral_6();
+// Evaluations needed by the generic engine for the same accuracy, on the
+// smooth integrand above and on a sharply peaked one.
+void compareRules()
+{
+	auto row = [](const char* name, QuadratureResult r, double exact)
+	{
+		cout << "  " << left << setw(24) << name << right << setw(12) << r.evaluations
+			 << " evals, error " << scientific << setprecision(2) << fabs(r.value - exact)
+			 << defaultfloat << setprecision(6) << '\n';
+	};
+
+	const double pi = acos(-1.0);
+	auto smooth = [](double x){ return 4.0 / (1.0 + x*x); };
+	cout << "4/(1+x^2) on [0, 1]:\n";
+	row("midpoint (integral_6)", midpointRule(smooth, 0.0, 1.0, num_steps), pi);
+	row("Simpson", simpsonRule(smooth, 0.0, 1.0, 2'000), pi);
+	row("Gauss-Legendre 5", gaussLegendreRule(smooth, 0.0, 1.0, 20), pi);
+	row("adaptive Gauss-Kronrod", adaptiveGaussKronrod(smooth, 0.0, 1.0, 1e-13), pi);
+
+	constexpr double eps = 1e-3;				// Peak of width eps at x = 0.3
+	auto peaked = [](double x){ return 1.0 / (eps*eps + (x - 0.3)*(x - 0.3)); };
+	const double exact = (atan(0.7 / eps) + atan(0.3 / eps)) / eps;
+	cout << "1/(eps^2+(x-0.3)^2) on [0, 1]:\n";
+	row("midpoint", midpointRule(peaked, 0.0, 1.0, 1'000'000), exact);
+	row("Simpson", simpsonRule(peaked, 0.0, 1.0, 1'000'000), exact);
+	row("adaptive Gauss-Kronrod", adaptiveGaussKronrod(peaked, 0.0, 1.0, 1e-9), exact);
+}
+
+
+
+// Runs one variant under START_TIMER and prints its throughput.
+// Every step costs 6 flops: add and mul for x, mul and add for 1+x^2, div, add.
+// Variants that do not walk num_steps pass flops = 0.
+void report(const char* name, double (*integral)(), double flops = 6.0 * num_steps)
+{
+	double res;
+	const auto t = steady_clock::now();
+	START_TIMER(name)
+		res = integral();
 	STOP_TIMER
-	cout << "Intergal_6 is " << d6 << "\n";
+	const double sec = duration<double>(steady_clock::now() - t).count();
+	cout << "Integral is " << res;
+	if ( flops > 0 )
+		cout << ", " << flops / sec * 1e-9 << " GFLOP/s";
+	cout << '\n';
+}
+
+
+
+// integral_6 with the schedule taken from omp_set_schedule(), for the sweep
+double integral_6_runtime()
+{
+	double sum = 0.0;
+
+	#pragma omp parallel for reduction(+ : sum) schedule(runtime) num_threads(num_threads)
+		for ( uint64_t i = 0; i < num_steps; ++i )
+		{
+			const double x = (i + 0.5) * step;
+			sum += 4.0 / (1.0 + x*x);
+		}
+
+	return (step * sum);
+}
+
+
+
+// Benchmark mode: every variant for every thread count from 1 to
+// hardware_concurrency, one warmup run and `repeats` timed runs each.
+// Speedup is relative to the same variant with one thread. Variants that do
+// not use num_threads (serial integral_1, integral_9 on the TBB pool) run
+// once, with the thread count they really use and no speedup.
+
+struct SweepResult
+{
+	string variant;
+	string schedule;
+	uint32_t threads;
+	bool scales;
+	double median_ms;
+	double min_ms;
+	double speedup;
+	double efficiency;
+};
+
+SweepResult measure(const string& variant, const string& schedule,
+	double (*integral)(), uint32_t repeats, double one_thread_ms)
+{
+	BenchmarkOptions opt;
+	opt.samples = repeats;
+	opt.iterations = 1;							// Every run is long enough on its own
+	const BenchmarkStats st = runBenchmark(variant, [integral](){ doNotOptimize(integral()); }, opt);
+	const double median = st.median * 1e-6;
+	const double base = (one_thread_ms > 0 ? one_thread_ms : median);
+	return {variant, schedule, num_threads, true, median, st.minNs() * 1e-6,
+		base / median, base / median / num_threads};
+}
+
+vector<SweepResult> sweep(uint32_t repeats)
+{
+	const uint32_t max_threads = max(1u, thread::hardware_concurrency());
+	struct Variant
+	{
+		const char* name;
+		double (*func)();
+		uint32_t fixed_threads;						// 0 = follows num_threads
+	};
+	const Variant variants[] = {
+		{"integral_1", integral_1, 1}, {"integral_2", integral_2, 0}, {"integral_3", integral_3, 0},
+		{"integral_4", integral_4, 0}, {"integral_5", integral_5, 0}, {"integral_6", integral_6, 0},
+		{"integral_7", integral_7, 0}, {"integral_8", integral_8, 0}, {"integral_9", integral_9, max_threads},
+		{"integral_10", integral_10, 0}};
+	const pair<omp_sched_t, const char*> kinds[] = {
+		{omp_sched_static, "static"}, {omp_sched_dynamic, "dynamic"}, {omp_sched_guided, "guided"}};
+	const int chunks[] = {0, 1'000, 100'000};		// 0 is the implementation default
+
+	vector<SweepResult> results;
+	vector<double> one_thread_ms;
+	for ( num_threads = 1; num_threads <= max_threads; ++num_threads )
+	{
+		size_t k = 0;
+		for ( const Variant& v : variants )
+		{
+			if ( v.fixed_threads && num_threads > 1 )
+			{
+				++k;
+				continue;
+			}
+			results.push_back(measure(v.name, "", v.func, repeats,
+				num_threads == 1 ? 0.0 : one_thread_ms[k]));
+			if ( v.fixed_threads )
+			{
+				results.back().threads = v.fixed_threads;
+				results.back().scales = false;
+			}
+			if ( num_threads == 1 )  one_thread_ms.push_back(results.back().median_ms);
+			++k;
+		}
+		for ( const auto& [kind, kind_name] : kinds )
+			for ( int chunk : chunks )
+			{
+				omp_set_schedule(kind, chunk);
+				const string schedule = string(kind_name) + "," + to_string(chunk);
+				results.push_back(measure("integral_6_runtime", schedule, integral_6_runtime,
+					repeats, num_threads == 1 ? 0.0 : one_thread_ms[k]));
+				if ( num_threads == 1 )  one_thread_ms.push_back(results.back().median_ms);
+				++k;
+			}
+	}
+	return results;
+}
+
+// Speedup and efficiency are left empty (CSV) or null (JSON) for variants that do not scale
+void printCsv(const vector<SweepResult>& results)
+{
+	cout << "variant,schedule,threads,scales,median_ms,min_ms,speedup,efficiency\n";
+	for ( const auto& r : results )
+	{
+		cout << r.variant << ",\"" << r.schedule << "\"," << r.threads << ',' << r.scales << ','
+			 << r.median_ms << ',' << r.min_ms << ',';
+		if ( r.scales )
+			cout << r.speedup << ',' << r.efficiency;
+		else
+			cout << ',';
+		cout << '\n';
+	}
+}
+
+// Host name and CPU model, so results from different machines can be told apart
+pair<string, string> hostDescription()
+{
+	char host[256] = {};
+	if ( gethostname(host, sizeof(host) - 1) != 0 )
+		host[0] = '\0';
+	string cpu = "unknown";
+	ifstream cpuinfo("/proc/cpuinfo");
+	for ( string line; getline(cpuinfo, line); )
+		if ( line.rfind("model name", 0) == 0 && line.find(':') != string::npos )
+		{
+			cpu = line.substr(line.find_first_not_of(" \t", line.find(':') + 1));
+			break;
+		}
+	return {host, cpu};
+}
+
+void printJson(const vector<SweepResult>& results)
+{
+#if defined(__clang__)
+	const char* compiler = "clang " __VERSION__;
+#else
+	const char* compiler = "gcc " __VERSION__;
+#endif
+	const auto [host, cpu] = hostDescription();
+	cout << "{\n  \"compiler\": \"" << compiler << "\",\n"
+		 << "  \"host\": \"" << host << "\",\n  \"cpu\": \"" << cpu << "\",\n"
+		 << "  \"hardware_concurrency\": " << thread::hardware_concurrency() << ",\n"
+		 << "  \"num_steps\": " << num_steps << ",\n  \"results\": [\n";
+	for ( size_t i = 0; i < results.size(); ++i )
+	{
+		const auto& r = results[i];
+		cout << "    {\"variant\": \"" << r.variant << "\", \"schedule\": \"" << r.schedule
+			 << "\", \"threads\": " << r.threads << ", \"scales\": " << (r.scales ? "true" : "false")
+			 << ", \"median_ms\": " << r.median_ms << ", \"min_ms\": " << r.min_ms;
+		if ( r.scales )
+			cout << ", \"speedup\": " << r.speedup << ", \"efficiency\": " << r.efficiency;
+		else
+			cout << ", \"speedup\": null, \"efficiency\": null";
+		cout << '}'
+			 << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	cout << "  ]\n}\n";
+}
+
+
+
+// Per-call cost of every SIMD kernel on one block, with hardware counters
+// when perf_event_open is permitted
+void microBenchmarks()
+{
+	constexpr uint64_t block = 1 << 16;
+	vector<pair<const char*, Kernel>> kernels = {{"kernelScalar", kernelScalar}};
+#if defined(__x86_64__)
+	kernels.push_back({"kernelSse2", kernelSse2});
+	if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") )
+		kernels.push_back({"kernelAvx2", kernelAvx2});
+	if ( __builtin_cpu_supports("avx512f") )
+		kernels.push_back({"kernelAvx512", kernelAvx512});
+#endif
+	for ( const auto& [name, k] : kernels )
+		printBenchmark(runBenchmark(name, [k](){ doNotOptimize(k(0, block)); }));
+}
+
+
+
+// Usage: a.out                          -- run every variant once
+//        a.out --sweep [csv|json] [N]   -- thread/schedule sweep, N timed runs per point
+//        a.out --micro                  -- per-call statistics of the SIMD kernels
+int main(int argc, char* argv[])
+{
+	if ( argc > 1 && string(argv[1]) == "--micro" )
+	{
+		microBenchmarks();
+		return 0;
+	}
+
+	if ( argc > 1 && string(argv[1]) == "--sweep" )
+	{
+		const string format = (argc > 2 ? argv[2] : "csv");
+		const uint32_t repeats = (argc > 3 ? max(1, atoi(argv[3])) : 5);
+		const vector<SweepResult> results = sweep(repeats);
+		if ( format == "json" )
+			printJson(results);
+		else
+			printCsv(results);
+		return 0;
+	}
+
+	report("integral_1: ", integral_1);
+	report("integral_2: ", integral_2);
+	report("integral_3: ", integral_3);
+	report("integral_4: ", integral_4);
+	report("integral_5: ", integral_5);
+	report("integral_6: ", integral_6);
+	cout << "SIMD kernel: " << kernel_name << '\n';
+	report("integral_7: ", integral_7);
+	report("integral_8: ", integral_8, 0);
+	report("integral_9: ", integral_9);
+	report("integral_10: ", integral_10);
+	compareRules();
 }
 
-// g++ -std=c++20 -Wall -Wextra -fopenmp integral.cpp
+// g++ -std=c++20 -Wall -Wextra -O2 -fopenmp integral.cpp -ltbb
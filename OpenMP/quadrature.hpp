@@ -0,0 +1,184 @@
+#pragma once
+
+// Parallel numerical integration of any callable f(double) -> double on [a, b].
+// Fixed composite rules (midpoint, Simpson, 5-point Gauss-Legendre) split the
+// panels statically between OpenMP threads. Each thread keeps a Kahan sum and
+// the per-thread partials are added pairwise, so the result does not drift
+// with the number of panels or threads.
+// adaptiveGaussKronrod() bisects only the panels whose G7/K15 error estimate
+// is above the tolerance and runs the two halves as OpenMP tasks.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <omp.h>
+
+
+
+struct QuadratureResult
+{
+	double value;
+	double error;				// Estimate, zero for fixed rules
+	uint64_t evaluations;		// Calls of the integrand
+};
+
+
+
+class KahanSum
+{
+public:
+	void add(double v)
+	{
+		const double y = v - c_;
+		const double t = sum_ + y;
+		c_ = (t - sum_) - y;
+		sum_ = t;
+	}
+
+	double value() const { return sum_; }
+
+private:
+	double sum_ = 0.0;
+	double c_ = 0.0;			// Lost low-order bits
+};
+
+
+
+inline double pairwiseSum(const double* v, size_t n)
+{
+	if ( n == 0 )  return 0.0;
+	if ( n == 1 )  return v[0];
+	return pairwiseSum(v, n / 2) + pairwiseSum(v + n / 2, n - n / 2);
+}
+
+
+
+// Sums term(i) for i in [0, n) in parallel with compensated partial sums
+template <typename Term>
+double parallelSum(uint64_t n, const Term& term)
+{
+	std::vector<double> partial(omp_get_max_threads(), 0.0);
+	#pragma omp parallel
+	{
+		const uint64_t id = omp_get_thread_num();
+		const uint64_t nthrds = omp_get_num_threads();
+		KahanSum sum;
+		for ( uint64_t i = n * id / nthrds; i < n * (id + 1) / nthrds; ++i )
+			sum.add(term(i));
+		partial[id] = sum.value();
+	}
+	return pairwiseSum(partial.data(), partial.size());
+}
+
+
+
+template <typename Function>
+QuadratureResult midpointRule(const Function& f, double a, double b, uint64_t n)
+{
+	const double h = (b - a) / n;
+	const double sum = parallelSum(n, [&](uint64_t i){ return f(a + (i + 0.5) * h); });
+	return {h * sum, 0.0, n};
+}
+
+
+
+template <typename Function>
+QuadratureResult simpsonRule(const Function& f, double a, double b, uint64_t n)
+{
+	n += n % 2;					// Needs an even number of intervals
+	const double h = (b - a) / n;
+	const double inner = parallelSum(n / 2, [&](uint64_t i)
+	{
+		const double x = a + (2 * i + 1) * h;
+		return 4.0 * f(x) + (i + 1 < n / 2 ? 2.0 * f(x + h) : 0.0);
+	});
+	return {h / 3.0 * (f(a) + inner + f(b)), 0.0, n + 1};
+}
+
+
+
+// Composite 5-point Gauss-Legendre rule, exact for polynomials of degree 9 on every panel
+template <typename Function>
+QuadratureResult gaussLegendreRule(const Function& f, double a, double b, uint64_t panels)
+{
+	static constexpr double x[3] = {0.0, 0.5384693101056830910, 0.9061798459386639928};
+	static constexpr double w[3] = {0.5688888888888888889, 0.4786286704993664680, 0.2369268850561890875};
+	const double h = (b - a) / panels;
+	const double sum = parallelSum(panels, [&](uint64_t i)
+	{
+		const double c = a + (i + 0.5) * h;
+		const double r = 0.5 * h;
+		return w[0] * f(c)
+			+ w[1] * (f(c - r * x[1]) + f(c + r * x[1]))
+			+ w[2] * (f(c - r * x[2]) + f(c + r * x[2]));
+	});
+	return {0.5 * h * sum, 0.0, 5 * panels};
+}
+
+
+
+// Gauss-Kronrod 7/15 rule on one panel (nodes and weights from QUADPACK)
+template <typename Function>
+QuadratureResult gaussKronrod15(const Function& f, double a, double b)
+{
+	static constexpr double xgk[8] = {
+		0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+		0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+		0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+		0.207784955007898467600689403773245, 0.0};
+	static constexpr double wgk[8] = {
+		0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+		0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+		0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+		0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+	static constexpr double wg[4] = {					// Gauss nodes are xgk[1], xgk[3], xgk[5], xgk[7]
+		0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+		0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+	const double c = 0.5 * (a + b);
+	const double r = 0.5 * (b - a);
+	const double fc = f(c);
+	double kronrod = wgk[7] * fc;
+	double gauss = wg[3] * fc;
+	for ( int j = 0; j < 7; ++j )
+	{
+		const double pair = f(c - r * xgk[j]) + f(c + r * xgk[j]);
+		kronrod += wgk[j] * pair;
+		if ( j % 2 == 1 )  gauss += wg[j / 2] * pair;
+	}
+	return {r * kronrod, std::fabs(r * (kronrod - gauss)), 15};
+}
+
+
+
+template <typename Function>
+QuadratureResult adaptiveGaussKronrodTask(const Function& f, double a, double b,
+	double tol, uint32_t depth)
+{
+	constexpr uint32_t max_depth = 50;
+	constexpr uint32_t task_depth = 8;					// Deeper panels are too small for a task
+	const QuadratureResult whole = gaussKronrod15(f, a, b);
+	if ( whole.error <= tol || depth >= max_depth )
+		return whole;
+
+	const double m = 0.5 * (a + b);
+	QuadratureResult left, right;
+	#pragma omp task shared(left) if(depth < task_depth)
+		left = adaptiveGaussKronrodTask(f, a, m, 0.5 * tol, depth + 1);
+	right = adaptiveGaussKronrodTask(f, m, b, 0.5 * tol, depth + 1);
+	#pragma omp taskwait
+	return {left.value + right.value, left.error + right.error,
+		whole.evaluations + left.evaluations + right.evaluations};
+}
+
+
+
+template <typename Function>
+QuadratureResult adaptiveGaussKronrod(const Function& f, double a, double b, double tol)
+{
+	QuadratureResult res;
+	#pragma omp parallel
+	#pragma omp single
+		res = adaptiveGaussKronrodTask(f, a, b, tol, 0);
+	return res;
+}
@@ -1,28 +1,247 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 
 
+// Keeps the compiler from optimizing away a value or the stores before it
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobberMemory()
+{
+	asm volatile("" : : : "memory");
+}
+
+
+
+// Hardware counters of the calling thread via perf_event_open(2), plus the
+// threads it starts meanwhile once they have exited. Not available on other
+// systems, in most containers, or when /proc/sys/kernel/perf_event_paranoid
+// forbids it; then valid() is false and all counts are zero.
+struct PerfCounts
+{
+	uint64_t cycles = 0;
+	uint64_t instructions = 0;
+	uint64_t cache_misses = 0;
+	uint64_t branch_misses = 0;
+
+	PerfCounts& operator+=(const PerfCounts& o)
+	{
+		cycles += o.cycles;
+		instructions += o.instructions;
+		cache_misses += o.cache_misses;
+		branch_misses += o.branch_misses;
+		return *this;
+	}
+};
+
+class PerfCounters
+{
+public:
+	PerfCounters()
+	{
+#if defined(__linux__)
+		const uint64_t configs[num_events] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+		for ( int k = 0; k < num_events; ++k )
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = configs[k];
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.inherit = 1;
+			fds_[k] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+			if ( fds_[k] < 0 )
+			{
+				close();
+				return;
+			}
+		}
+#endif
+	}
+
+	~PerfCounters() { close(); }
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool valid() const { return fds_[0] >= 0; }
+
+	void start()
+	{
+#if defined(__linux__)
+		for ( int fd : fds_ )
+			if ( fd >= 0 )
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+	}
+
+	PerfCounts stop()
+	{
+		uint64_t v[num_events] = {};
+#if defined(__linux__)
+		for ( int k = 0; k < num_events; ++k )
+			if ( fds_[k] >= 0 )
+			{
+				ioctl(fds_[k], PERF_EVENT_IOC_DISABLE, 0);
+				if ( read(fds_[k], &v[k], sizeof(v[k])) != sizeof(v[k]) )  v[k] = 0;
+			}
+#endif
+		return {v[0], v[1], v[2], v[3]};
+	}
+
+private:
+	static constexpr int num_events = 4;
+
+	void close()
+	{
+#if defined(__linux__)
+		for ( int& fd : fds_ )
+			if ( fd >= 0 )
+			{
+				::close(fd);
+				fd = -1;
+			}
+#endif
+	}
+
+	int fds_[num_events] = {-1, -1, -1, -1};
+};
+
+
+
+// Statistics over the per-call times of the samples of one benchmark.
+// The 99th percentile needs enough samples to differ from the maximum; with
+// fewer than min_p99_samples p99 is NaN and not printed.
+constexpr size_t min_p99_samples = 100;
+
+struct BenchmarkStats
+{
+	std::string name;
+	uint64_t iterations;				// Calls per sample
+	std::vector<double> ns;				// Per-call time of every sample, sorted
+	double median, p99, mean, stddev;
+	bool has_counters;
+	double cycles, instructions;		// Per call, averaged over all samples
+	double cache_misses, branch_misses;
+
+	double minNs() const { return ns.front(); }
+};
+
+inline BenchmarkStats summarize(const std::string& name, uint64_t iterations, std::vector<double> ns,
+	const PerfCounts& total, bool has_counters)
+{
+	BenchmarkStats st;
+	st.name = name;
+	st.iterations = iterations;
+	st.ns = std::move(ns);
+	std::sort(st.ns.begin(), st.ns.end());
+
+	const size_t k = st.ns.size();
+	st.median = st.ns[k / 2];
+	st.p99 = (k >= min_p99_samples ? st.ns[size_t(std::ceil(0.99 * k)) - 1] : NAN);
+	double sum = 0, sq = 0;
+	for ( double v : st.ns )  sum += v;
+	st.mean = sum / k;
+	for ( double v : st.ns )  sq += (v - st.mean) * (v - st.mean);
+	st.stddev = std::sqrt(sq / k);
+
+	const double calls = double(iterations) * k;
+	st.has_counters = has_counters;
+	st.cycles = total.cycles / calls;
+	st.instructions = total.instructions / calls;
+	st.cache_misses = total.cache_misses / calls;
+	st.branch_misses = total.branch_misses / calls;
+	return st;
+}
+
+inline void printCounters(const BenchmarkStats& st)
+{
+	if ( !st.has_counters )  return;
+	std::cout << std::fixed << std::setprecision(1) << "  cycles " << st.cycles << std::setprecision(2)
+		<< "  IPC " << (st.cycles > 0 ? st.instructions / st.cycles : 0.0)
+		<< "  cache-miss " << st.cache_misses
+		<< "  branch-miss " << st.branch_misses;
+}
+
+
+
+// One sample of the harness: wall time and hardware counters of a region.
+// With a message it prints them when it goes out of scope, which is what
+// START_TIMER / STOP_TIMER do; runBenchmark() takes every sample with one.
 class TimeMeasurer
 {
 public:
-	TimeMeasurer(const char* mes) : mes_ {mes}
+	explicit TimeMeasurer(const char* mes = nullptr) : mes_ {mes}
 	{
+		perf_.start();
 		t1_ = std::chrono::steady_clock::now();
 	}
 
 	~TimeMeasurer()
 	{
-		auto t2_ = std::chrono::steady_clock::now() - t1_;
-		std::cout << mes_
-			<< std::chrono::duration_cast<std::chrono::milliseconds>(t2_).count()
-			<< " ms\n";
+		if ( !mes_ )  return;
+		PerfCounts counts;
+		const double ns = stop(counts);
+		const BenchmarkStats st = summarize(mes_, 1, {ns}, counts, perf_.valid());
+		const std::ios_base::fmtflags flags = std::cout.flags();
+		const std::streamsize precision = std::cout.precision();
+		std::cout << mes_ << std::fixed << std::setprecision(3) << st.median * 1e-6 << " ms";
+		printCounters(st);
+		std::cout << '\n';
+		std::cout.flags(flags);
+		std::cout.precision(precision);
+	}
+
+	TimeMeasurer(const TimeMeasurer&) = delete;
+	TimeMeasurer& operator=(const TimeMeasurer&) = delete;
+
+	double elapsedMs() const
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - t1_).count();
 	}
 
+	// Ends the sample, returns its time in ns and the counts of the region
+	double stop(PerfCounts& counts)
+	{
+		const double ns = std::chrono::duration<double, std::nano>(
+			std::chrono::steady_clock::now() - t1_).count();
+		counts = perf_.stop();
+		return ns;
+	}
+
+	bool hasCounters() const { return perf_.valid(); }
+
 private:
 	const char* mes_;
+	PerfCounters perf_;
 	std::chrono::time_point<std::chrono::steady_clock> t1_;
 };
 
@@ -30,3 +249,67 @@ private:
 
 #define START_TIMER(mes) { TimeMeasurer tm(mes);
 #define STOP_TIMER  }
+
+
+
+// Micro-benchmark runner built on TimeMeasurer.
+// Runs `warmup` calls, then doubles the batch size until one batch takes at
+// least min_sample_ms (unless iterations is fixed), then times `samples`
+// batches and reports per-call statistics over them.
+struct BenchmarkOptions
+{
+	uint32_t warmup = 1;
+	uint32_t samples = 100;				// Enough for p99, see min_p99_samples
+	double min_sample_ms = 2.0;
+	uint64_t iterations = 0;			// Calls per sample, 0 = calibrate
+};
+
+template <typename Function>
+BenchmarkStats runBenchmark(const std::string& name, Function func, BenchmarkOptions opt = {})
+{
+	PerfCounts total;
+	bool has_counters = true;
+	auto timeBatch = [&](uint64_t n)
+	{
+		TimeMeasurer tm;
+		for ( uint64_t i = 0; i < n; ++i )
+			func();
+		clobberMemory();
+		PerfCounts counts;
+		const double ns = tm.stop(counts);
+		total += counts;
+		has_counters = has_counters && tm.hasCounters();
+		return ns;
+	};
+
+	for ( uint32_t i = 0; i < opt.warmup; ++i )
+		func();
+
+	uint64_t n = opt.iterations;
+	if ( n == 0 )
+		for ( n = 1; timeBatch(n) < opt.min_sample_ms * 1e6 && n < (uint64_t(1) << 40); )
+			n *= 2;
+
+	total = PerfCounts();						// Count the timed samples only
+	has_counters = true;
+	std::vector<double> ns;
+	for ( uint32_t s = 0; s < std::max(1u, opt.samples); ++s )
+		ns.push_back(timeBatch(n) / n);
+	return summarize(name, n, std::move(ns), total, has_counters);
+}
+
+inline void printBenchmark(const BenchmarkStats& st)
+{
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+	std::cout << std::left << std::setw(24) << st.name << std::right << std::fixed
+		<< std::setprecision(1) << "  median " << std::setw(12) << st.median << " ns";
+	if ( !std::isnan(st.p99) )
+		std::cout << "  p99 " << std::setw(12) << st.p99 << " ns";
+	std::cout << "  stddev " << std::setw(10) << st.stddev
+		<< " ns  (" << st.ns.size() << " x " << st.iterations << ")";
+	printCounters(st);
+	std::cout << '\n';
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
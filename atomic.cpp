@@ -1,5 +1,6 @@
 // g++ atomic.cpp -std=c++20 -Wall -Wextra -pthread -latomic -o zzz
 
+#include "seqlock_atomic.h"
 #include <atomic>
 #include <cassert>
 #include <iostream>
@@ -143,4 +144,10 @@ int main()
 		 << ac.is_lock_free() << ' ' << i.is_lock_free() << ' '
 		 << ad.is_lock_free() << ' ' << p.is_lock_free() << ' '
 		 << abar.is_lock_free() << ' ' << abaz.is_lock_free() << '\n';
+
+	// Lock-free alternative for large trivially copyable types (single writer)
+	SeqlockAtomic<Bar> sbar;
+	sbar.store(Bar {'b', 1, 2.0, "bar"});
+	cout << "SeqlockAtomic<Bar> is lock free: " << sbar.is_always_lock_free
+		 << ' ' << sbar.load().s << '\n';
 }
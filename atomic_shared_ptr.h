@@ -0,0 +1,216 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+
+
+// Lock-free replacement for atomic<shared_ptr<T>> based on split reference
+// counting. The atomic word packs a pointer to a control node (low 48 bits)
+// with an external counter (high 16 bits), so a single 64-bit CAS is enough.
+// Readers bump the external counter to pin the node, copy its shared_ptr and
+// then give their reference back either to the external counter (if the node
+// is still published) or to the internal counter of the detached node.
+
+template <typename T>
+class AtomicSharedPtr
+{
+public:
+	AtomicSharedPtr() : packed_ {0} {}
+	AtomicSharedPtr(shared_ptr<T> desired) : packed_ {makePacked(move(desired))} {}
+	~AtomicSharedPtr() { detach(packed_.load(memory_order_relaxed), 1); }
+
+	AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+	AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+	bool is_lock_free() const { return packed_.is_lock_free(); }
+
+	shared_ptr<T> load() const;
+	void store(shared_ptr<T> desired);
+	shared_ptr<T> exchange(shared_ptr<T> desired);
+	bool compare_exchange_strong(shared_ptr<T>& expected, shared_ptr<T> desired);
+	bool compare_exchange_weak(shared_ptr<T>& expected, shared_ptr<T> desired)
+		{ return compare_exchange_strong(expected, move(desired)); }
+
+	operator shared_ptr<T>() const { return load(); }
+	AtomicSharedPtr& operator=(shared_ptr<T> desired)
+		{ store(move(desired)); return *this; }
+
+private:
+	struct ControlNode
+	{
+		shared_ptr<T> data;
+		atomic<int64_t> internal_count;		// Released (negative) or transferred references
+		ControlNode(shared_ptr<T>&& d) : data {move(d)}, internal_count {0} {}
+	};
+
+	static_assert(sizeof(void*) == 8, "Pointer packing requires a 64-bit platform");
+	static constexpr uint32_t count_shift = 48;
+	static constexpr uint64_t ptr_mask = (uint64_t(1) << count_shift) - 1;
+	static constexpr uint64_t count_one = uint64_t(1) << count_shift;
+	static constexpr uint64_t count_max = 0xFFFF;
+
+	static ControlNode* nodeOf(uint64_t p)
+		{ return reinterpret_cast<ControlNode*>(p & ptr_mask); }
+	static uint64_t countOf(uint64_t p) { return p >> count_shift; }
+
+	static uint64_t makePacked(shared_ptr<T>&& desired);
+	static void detach(uint64_t old, uint64_t own_refs);
+	ControlNode* acquire(uint64_t& observed) const;
+	void release(ControlNode* node) const;
+
+	mutable atomic<uint64_t> packed_;
+};
+
+
+
+template <typename T>
+uint64_t AtomicSharedPtr<T>::makePacked(shared_ptr<T>&& desired)
+{
+	if ( !desired )  return 0;
+	const auto raw = reinterpret_cast<uintptr_t>(new ControlNode(move(desired)));
+	return raw | count_one;					// External count 1 is owned by the atomic itself
+}
+
+
+
+// Called by whoever unpublished the node. All external references except
+// own_refs are still outstanding, so they move to the internal counter.
+template <typename T>
+void AtomicSharedPtr<T>::detach(uint64_t old, uint64_t own_refs)
+{
+	ControlNode* const node = nodeOf(old);
+	if ( !node )  return;
+	const int64_t outstanding = int64_t(countOf(old)) - int64_t(own_refs);
+	if ( node->internal_count.fetch_add(outstanding, memory_order_acq_rel) + outstanding == 0 )
+		delete node;
+}
+
+
+
+// Pins the currently published node by incrementing its external count.
+template <typename T>
+typename AtomicSharedPtr<T>::ControlNode*
+AtomicSharedPtr<T>::acquire(uint64_t& observed) const
+{
+	observed = packed_.load(memory_order_acquire);
+	while ( true )
+	{
+		if ( !nodeOf(observed) )  return nullptr;
+		if ( countOf(observed) == count_max )	// Too many concurrent readers, let them drain
+		{
+			this_thread::yield();
+			observed = packed_.load(memory_order_acquire);
+			continue;
+		}
+		const uint64_t pinned = observed + count_one;
+		if ( packed_.compare_exchange_weak(observed, pinned,
+				memory_order_acq_rel, memory_order_acquire) )
+		{
+			observed = pinned;
+			return nodeOf(pinned);
+		}
+	}
+}
+
+
+
+template <typename T>
+void AtomicSharedPtr<T>::release(ControlNode* node) const
+{
+	uint64_t p = packed_.load(memory_order_acquire);
+	while ( nodeOf(p) == node )				// Still published: return the external reference
+	{
+		if ( packed_.compare_exchange_weak(p, p - count_one,
+				memory_order_acq_rel, memory_order_acquire) )
+			return;
+	}
+	if ( node->internal_count.fetch_sub(1, memory_order_acq_rel) == 1 )
+		delete node;
+}
+
+
+
+template <typename T>
+shared_ptr<T> AtomicSharedPtr<T>::load() const
+{
+	uint64_t observed;
+	ControlNode* const node = acquire(observed);
+	if ( !node )  return shared_ptr<T>();
+	shared_ptr<T> res = node->data;
+	release(node);
+	return res;
+}
+
+
+
+template <typename T>
+void AtomicSharedPtr<T>::store(shared_ptr<T> desired)
+{
+	detach(packed_.exchange(makePacked(move(desired)), memory_order_acq_rel), 1);
+}
+
+
+
+template <typename T>
+shared_ptr<T> AtomicSharedPtr<T>::exchange(shared_ptr<T> desired)
+{
+	const uint64_t old = packed_.exchange(makePacked(move(desired)), memory_order_acq_rel);
+	shared_ptr<T> res;
+	if ( ControlNode* const node = nodeOf(old) )
+		res = node->data;					// Copy, concurrent readers may still use it
+	detach(old, 1);
+	return res;
+}
+
+
+
+template <typename T>
+bool AtomicSharedPtr<T>::compare_exchange_strong(shared_ptr<T>& expected, shared_ptr<T> desired)
+{
+	auto same = [](const shared_ptr<T>& a, const shared_ptr<T>& b)
+		{ return a == b && !a.owner_before(b) && !b.owner_before(a); };
+
+	const uint64_t replacement = makePacked(move(desired));
+	while ( true )
+	{
+		uint64_t observed;
+		ControlNode* const node = acquire(observed);
+		if ( !node )
+		{
+			if ( expected )
+			{
+				expected.reset();
+				detach(replacement, 1);
+				return false;
+			}
+			uint64_t empty = 0;
+			if ( packed_.compare_exchange_strong(empty, replacement, memory_order_acq_rel) )
+				return true;
+			continue;
+		}
+
+		if ( !same(node->data, expected) )
+		{
+			expected = node->data;
+			release(node);
+			detach(replacement, 1);
+			return false;
+		}
+
+		while ( nodeOf(observed) == node )
+		{
+			if ( packed_.compare_exchange_weak(observed, replacement,
+					memory_order_acq_rel, memory_order_acquire) )
+			{
+				detach(observed, 2);		// The atomic's own reference and ours
+				return true;
+			}
+		}
+		release(node);						// Replaced behind our back, start over
+	}
+}
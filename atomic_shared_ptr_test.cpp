@@ -0,0 +1,95 @@
+#include "atomic_shared_ptr.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+void testAtomicSharedPtr()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	AtomicSharedPtr<string> asp;
+	cout << boolalpha << "AtomicSharedPtr is lock free? " << asp.is_lock_free() << '\n';
+	assert(asp.is_lock_free());
+	assert(asp.load() == nullptr);
+
+	asp.store(make_shared<string>("one"));
+	shared_ptr<string> p1 = asp.load();
+	assert(*p1 == "one" && p1.use_count() == 2);
+
+	shared_ptr<string> old = asp.exchange(make_shared<string>("two"));
+	assert(old == p1 && *asp.load() == "two");
+
+	shared_ptr<string> expected = p1;				// Stale value
+	assert(!asp.compare_exchange_strong(expected, make_shared<string>("three")));
+	assert(*expected == "two");
+	assert(asp.compare_exchange_strong(expected, make_shared<string>("three")));
+	cout << *p1 << ' ' << *expected << ' ' << *asp.load() << '\n';
+	assert(*asp.load() == "three");
+
+	asp.store(nullptr);
+	assert(asp.load() == nullptr && expected.use_count() == 1);
+}
+
+
+
+struct Config
+{
+	uint64_t version;
+	uint64_t checksum;				// Always version * 3
+};
+
+template <typename Atomic>
+uint64_t publishConfigs(Atomic& cfg, uint32_t num_readers, uint32_t num_reads)
+{
+	atomic<uint32_t> readers_left {num_readers};
+	vector<thread> readers;
+	for ( uint32_t r = 0; r < num_readers; ++r )
+		readers.emplace_back([&]()
+		{
+			for ( uint32_t i = 0; i < num_reads; ++i )
+			{
+				const shared_ptr<Config> c = cfg.load();
+				assert(c->checksum == c->version * 3);
+			}
+			--readers_left;
+		});
+
+	uint64_t v = 0;
+	while ( readers_left.load(memory_order_relaxed) > 0 )
+	{
+		++v;
+		cfg.store(make_shared<Config>(Config {v, v * 3}));
+		this_thread::yield();					// Read-mostly: writer is rare
+	}
+	for ( auto& th : readers )  th.join();
+	return v;
+}
+
+void testAtomicSharedPtrMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	using namespace std::chrono;
+	constexpr uint32_t num_readers = 3;
+	constexpr uint32_t num_reads = 1'000'000;
+
+	AtomicSharedPtr<Config> lf_cfg(make_shared<Config>(Config {0, 0}));
+	auto t = steady_clock::now();
+	uint64_t updates = publishConfigs(lf_cfg, num_readers, num_reads);
+	auto dur = duration_cast<milliseconds>(steady_clock::now() - t).count();
+	cout << "AtomicSharedPtr:        " << num_readers << " x " << num_reads << " reads, "
+		 << updates << " updates, " << dur << " ms, lock free " << lf_cfg.is_lock_free() << '\n';
+	assert(lf_cfg.load()->version == updates);
+
+	atomic<shared_ptr<Config>> std_cfg(make_shared<Config>(Config {0, 0}));
+	t = steady_clock::now();
+	updates = publishConfigs(std_cfg, num_readers, num_reads);
+	dur = duration_cast<milliseconds>(steady_clock::now() - t).count();
+	cout << "atomic<shared_ptr<T>>:  " << num_readers << " x " << num_reads << " reads, "
+		 << updates << " updates, " << dur << " ms, lock free " << std_cfg.is_lock_free() << '\n';
+}
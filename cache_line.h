@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+
+// Size of L1 cache line on x86-64 and most ARMv8 cores. Used to keep
+// independently written atomics apart and avoid false sharing.
+// (hardware_destructive_interference_size is not ABI-stable in GCC.)
+constexpr std::size_t cache_line_size = 64;
+
+
+
+// Small consecutive number of the calling thread, for picking its own
+// padded cell or slot: index & mask spreads threads evenly over the cells.
+inline std::uint32_t threadIndex()
+{
+	static std::atomic<std::uint32_t> next_thread {0};
+	thread_local const std::uint32_t thread_index = next_thread.fetch_add(1, std::memory_order_relaxed);
+	return thread_index;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "cache_line.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+
+
+// Chase-Lev work-stealing deque (C11 formulation by Le, Pop, Cohen and
+// Zappa Nardelli). The owner thread pushes and pops at the bottom (LIFO,
+// good cache locality for fork/join), other threads steal from the top
+// (FIFO, they take the oldest and usually largest pieces of work).
+// T must be trivially copyable, typically a pointer to a task.
+// Outgrown arrays are kept until destruction, since a thief may still read them.
+
+template <typename T>
+class ChaseLevDeque
+{
+public:
+	explicit ChaseLevDeque(size_t capacity = 256);
+
+	ChaseLevDeque(const ChaseLevDeque&) = delete;
+	ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+	void push(T value);						// Owner only
+	bool tryPop(T& value);					// Owner only
+	bool trySteal(T& value);				// Any thread
+
+	bool empty() const
+	{
+		return bottom_.load(memory_order_relaxed) <= top_.load(memory_order_relaxed);
+	}
+
+private:
+	struct Array
+	{
+		explicit Array(int64_t n) : mask {n - 1}, data {new atomic<T>[n]} {}
+		int64_t size() const { return mask + 1; }
+		T get(int64_t i) const { return data[i & mask].load(memory_order_relaxed); }
+		void put(int64_t i, T v) { data[i & mask].store(v, memory_order_relaxed); }
+
+		int64_t mask;
+		unique_ptr<atomic<T>[]> data;
+	};
+
+	Array* grow(Array* a, int64_t bottom, int64_t top);
+
+	alignas(cache_line_size) atomic<int64_t> top_ {0};		// Thieves
+	alignas(cache_line_size) atomic<int64_t> bottom_ {0};	// Owner
+	atomic<Array*> array_;
+	vector<unique_ptr<Array>> arrays_;						// Owner only
+};
+
+
+
+template <typename T>
+ChaseLevDeque<T>::ChaseLevDeque(size_t capacity)
+{
+	int64_t size = 2;
+	while ( size < int64_t(capacity) )  size <<= 1;
+	arrays_.emplace_back(new Array(size));
+	array_.store(arrays_.back().get(), memory_order_relaxed);
+}
+
+
+
+template <typename T>
+typename ChaseLevDeque<T>::Array* ChaseLevDeque<T>::grow(Array* a, int64_t bottom, int64_t top)
+{
+	arrays_.emplace_back(new Array(a->size() * 2));
+	Array* const bigger = arrays_.back().get();
+	for ( int64_t i = top; i < bottom; ++i )
+		bigger->put(i, a->get(i));
+	array_.store(bigger, memory_order_release);
+	return bigger;
+}
+
+
+
+template <typename T>
+void ChaseLevDeque<T>::push(T value)
+{
+	const int64_t b = bottom_.load(memory_order_relaxed);
+	const int64_t t = top_.load(memory_order_acquire);
+	Array* a = array_.load(memory_order_relaxed);
+	if ( b - t > a->size() - 1 )
+		a = grow(a, b, t);
+	a->put(b, value);
+	atomic_thread_fence(memory_order_release);
+	bottom_.store(b + 1, memory_order_relaxed);
+}
+
+
+
+template <typename T>
+bool ChaseLevDeque<T>::tryPop(T& value)
+{
+	const int64_t b = bottom_.load(memory_order_relaxed) - 1;
+	Array* const a = array_.load(memory_order_relaxed);
+	bottom_.store(b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);		// Order the bottom_ store before the top_ load
+	int64_t t = top_.load(memory_order_relaxed);
+	if ( t > b )									// Empty
+	{
+		bottom_.store(b + 1, memory_order_relaxed);
+		return false;
+	}
+	value = a->get(b);
+	if ( t == b )									// Last item, race against thieves
+	{
+		const bool won = top_.compare_exchange_strong(t, t + 1,
+			memory_order_seq_cst, memory_order_relaxed);
+		bottom_.store(b + 1, memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+
+
+template <typename T>
+bool ChaseLevDeque<T>::trySteal(T& value)
+{
+	int64_t t = top_.load(memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	const int64_t b = bottom_.load(memory_order_acquire);
+	if ( t >= b )  return false;
+	Array* const a = array_.load(memory_order_acquire);
+	const T v = a->get(t);
+	if ( !top_.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed) )
+		return false;								// Lost to the owner or another thief
+	value = v;
+	return true;
+}
@@ -0,0 +1,267 @@
+// make bench BENCH_ARGS="--threads 1,2,4,8 --mix 90:5:5 --keys 100000 --dist zipf:0.99"
+// ./zzz_bench [--containers map,map-integral,list,stack] [--threads 1,2,4,8] [--mix read:write:remove]
+//             [--keys N] [--dist uniform|zipf[:theta]|hot[:fraction:probability]] [--seconds S]
+//             [--latency] [--rate ops_per_second_per_thread]
+
+// Throughput of the concurrent containers under a synthetic workload, see
+// workload.h. Operations per container:
+//   ThreadsafeMap, IntegralThreadsafeMap (map, map-integral) read = getValue, write = addOrUpdate, remove = remove
+//   TreadsafeList  read = findFirstIf, write = pushFront unless found, remove = removeIf
+//   LockFreeStack  write = push, read and remove = pop (keys only fill the nodes)
+// --latency adds a percentile table of the operation times of every run.
+// --rate issues operations on a fixed schedule and adds the response times
+// measured from when each operation was due, corrected for coordinated omission.
+
+#include "latency_histogram.h"
+#include "lock_free_stack.h"
+#include "threadsafe_list.h"
+#include "threadsafe_map.h"
+#include "workload.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+
+template <typename Map>
+struct MapAdapter
+{
+	Map map;
+
+	explicit MapAdapter(const Workload& w) : map(uint32_t(max<uint64_t>(19, w.key_space / 4))) {}	// key_space <= 2^26
+	void prefill(uint64_t key) { map.addOrUpdate(key, key); }
+	void read(uint64_t key) { volatile uint64_t v = map.getValue(key, 0); (void)v; }
+	void write(uint64_t key) { map.addOrUpdate(key, key); }
+	void remove(uint64_t key) { map.remove(key); }
+};
+
+struct ListAdapter
+{
+	TreadsafeList<uint64_t> list;
+
+	explicit ListAdapter(const Workload&) {}
+	void prefill(uint64_t key) { list.pushFront(key); }
+	void read(uint64_t key) { list.findFirstIf([key](uint64_t v){ return v == key; }); }
+	void write(uint64_t key)		// Racing writers may still add a duplicate
+	{
+		if ( !list.findFirstIf([key](uint64_t v){ return v == key; }) )
+			list.pushFront(key);
+	}
+	void remove(uint64_t key) { list.removeIf([key](uint64_t v){ return v == key; }); }
+};
+
+struct StackAdapter
+{
+	LockFreeStack<uint64_t> stack;
+
+	explicit StackAdapter(const Workload&) {}
+	void prefill(uint64_t key) { stack.push(key); }
+	void read(uint64_t) { stack.pop(); }
+	void write(uint64_t key) { stack.push(key); }
+	void remove(uint64_t) { stack.pop(); }
+};
+
+
+
+template <typename Adapter>
+void benchContainer(const string& name, const Workload& w, const vector<uint32_t>& thread_counts)
+{
+	double base = 0.0;
+	vector<WorkloadResult> results;
+	for ( uint32_t n : thread_counts )
+	{
+		Adapter container(w);
+		results.push_back(runWorkload(container, w, n));
+		const WorkloadResult& res = results.back();
+		if ( base == 0.0 )  base = res.opsPerSec() / res.threads;
+		cout << left << setw(12) << name << right << setw(8) << n
+			 << fixed << setprecision(0) << setw(16) << res.opsPerSec()
+			 << setw(16) << res.opsPerSec() / n
+			 << setprecision(2) << setw(10) << res.opsPerSec() / base << '\n';
+	}
+	if ( results.front().latency.count() == 0 )  return;
+
+	printPercentileHeader();
+	for ( const WorkloadResult& res : results )
+	{
+		const string threads = " x" + to_string(res.threads);
+		printPercentiles(name + threads + " service", res.latency);
+		if ( res.response.count() > 0 )
+			printPercentiles(name + threads + " response", res.response);
+	}
+	cout << '\n';
+}
+
+
+
+vector<string> split(const string& s, char sep)
+{
+	vector<string> parts;
+	stringstream ss(s);
+	for ( string part; getline(ss, part, sep); )
+		parts.push_back(part);
+	return parts;
+}
+
+// Whole string must be a number within [lo, hi]
+bool parseNumber(const string& s, double lo, double hi, double& value)
+{
+	char* end = nullptr;
+	value = strtod(s.c_str(), &end);
+	return !s.empty() && *end == '\0' && value >= lo && value <= hi;
+}
+
+int usage(const char* prog, const string& error)
+{
+	cerr << error << "\nusage: " << prog << " [--containers map,map-integral,list,stack] [--threads 1,2,4,8]\n"
+		 << "    [--mix read:write:remove] (whole percentages adding up to 100)\n"
+		 << "    [--keys N] (2 <= N <= " << Workload::max_key_space << ")\n"
+		 << "    [--dist uniform|zipf[:theta]|hot[:fraction:probability]]\n"
+		 << "        (0 <= theta < 1, 0 < fraction <= 1, 0 <= probability <= 1)\n"
+		 << "    [--seconds S] (S > 0) [--latency]\n"
+		 << "    [--rate ops_per_second_per_thread] (0 = closed loop, else " << Workload::min_rate
+		 << " to " << Workload::max_rate << ")\n";
+	return 1;
+}
+
+const char* distributionName(KeyDistribution d)
+{
+	switch ( d )
+	{
+	case KeyDistribution::Uniform:  return "uniform";
+	case KeyDistribution::Zipfian:  return "zipf";
+	case KeyDistribution::HotSet:   return "hot";
+	}
+	return "";
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	Workload w;
+	vector<string> containers = {"map", "map-integral", "list", "stack"};
+	vector<uint32_t> thread_counts;
+	for ( uint32_t n = 1; n <= max(4u, thread::hardware_concurrency()); n *= 2 )
+		thread_counts.push_back(n);
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const string opt = argv[i];
+		if ( opt == "--latency" )
+		{
+			w.record_latency = true;
+			continue;
+		}
+		if ( i + 1 == argc )
+			return usage(argv[0], "Missing value of " + opt);
+		const string val = argv[++i];
+		double x = 0;
+		if ( opt == "--containers" )
+		{
+			containers = split(val, ',');
+			for ( const string& c : containers )
+				if ( c != "map" && c != "map-integral" && c != "list" && c != "stack" )
+					return usage(argv[0], "Unknown container " + c);
+			if ( containers.empty() )
+				return usage(argv[0], "No containers");
+		}
+		else if ( opt == "--threads" )
+		{
+			thread_counts.clear();
+			for ( const string& s : split(val, ',') )
+			{
+				if ( !parseNumber(s, 1, 4096, x) || x != uint32_t(x) )
+					return usage(argv[0], "Bad thread count " + s);
+				thread_counts.push_back(uint32_t(x));
+			}
+			if ( thread_counts.empty() )
+				return usage(argv[0], "No thread counts");
+		}
+		else if ( opt == "--mix" )
+		{
+			const vector<string> mix = split(val, ':');
+			uint32_t percent[3] = {};
+			bool ok = (mix.size() == 3);
+			for ( size_t k = 0; ok && k < 3; ++k )
+			{
+				ok = parseNumber(mix[k], 0, 100, x) && x == uint32_t(x);
+				percent[k] = uint32_t(x);
+			}
+			if ( !ok || percent[0] + percent[1] + percent[2] != 100 )
+				return usage(argv[0], "Bad mix " + val);
+			w.read_percent = percent[0];
+			w.write_percent = percent[1];
+		}
+		else if ( opt == "--keys" )
+		{
+			if ( !parseNumber(val, 2, double(Workload::max_key_space), x) || x != uint64_t(x) )
+				return usage(argv[0], "Bad key space " + val);
+			w.key_space = uint64_t(x);
+		}
+		else if ( opt == "--dist" )
+		{
+			const vector<string> dist = split(val, ':');
+			bool ok = !dist.empty();
+			if ( ok && dist[0] == "uniform" )
+			{
+				w.distribution = KeyDistribution::Uniform;
+				ok = (dist.size() == 1);
+			}
+			else if ( ok && dist[0] == "zipf" )
+			{
+				w.distribution = KeyDistribution::Zipfian;
+				ok = (dist.size() <= 2);
+				if ( ok && dist.size() > 1 )		// theta = 1 divides by zero in KeyChooser
+					ok = parseNumber(dist[1], 0, 1, w.zipf_theta) && w.zipf_theta < 1;
+			}
+			else if ( ok && dist[0] == "hot" )
+			{
+				w.distribution = KeyDistribution::HotSet;
+				ok = (dist.size() <= 3);
+				if ( ok && dist.size() > 1 )
+					ok = parseNumber(dist[1], 0, 1, w.hot_fraction) && w.hot_fraction > 0;
+				if ( ok && dist.size() > 2 )
+					ok = parseNumber(dist[2], 0, 1, w.hot_probability);
+			}
+			else
+				ok = false;
+			if ( !ok )
+				return usage(argv[0], "Bad distribution " + val);
+		}
+		else if ( opt == "--seconds" )
+		{
+			if ( !parseNumber(val, 0, 1e6, w.seconds) || w.seconds == 0 )
+				return usage(argv[0], "Bad duration " + val);
+		}
+		else if ( opt == "--rate" )
+		{
+			if ( !parseNumber(val, 0, Workload::max_rate, w.rate) || (w.rate > 0 && w.rate < Workload::min_rate) )
+				return usage(argv[0], "Bad rate " + val);
+		}
+		else
+			return usage(argv[0], "Unknown option " + opt);
+	}
+
+	cout << "mix " << w.read_percent << ':' << w.write_percent << ':'
+		 << 100 - w.read_percent - w.write_percent << ", " << w.key_space << " keys, "
+		 << distributionName(w.distribution) << ", " << w.seconds << " s per run";
+	if ( w.rate > 0 )  cout << ", " << w.rate << " ops/s per thread";
+	cout << '\n';
+	cout << left << setw(12) << "container" << right << setw(8) << "threads"
+		 << setw(16) << "ops/s" << setw(16) << "ops/s/thread" << setw(10) << "speedup" << '\n';
+	for ( const string& c : containers )
+		if ( c == "map" )
+			benchContainer<MapAdapter<ThreadsafeMap<uint64_t, uint64_t>>>(c, w, thread_counts);
+		else if ( c == "map-integral" )
+			benchContainer<MapAdapter<IntegralThreadsafeMap<uint64_t, uint64_t>>>(c, w, thread_counts);
+		else if ( c == "list" )
+			benchContainer<ListAdapter>(c, w, thread_counts);
+		else
+			benchContainer<StackAdapter>(c, w, thread_counts);
+}
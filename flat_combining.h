@@ -0,0 +1,141 @@
+#pragma once
+
+#include "cache_line.h"
+#include "wait_strategy.h"
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+
+
+// Flat combining (Hendler, Incze, Shavit, Tzafrir): turns a sequential data
+// structure into a concurrent one. apply(func) publishes a pointer to func
+// in the calling thread's slot. Whoever gets the combiner lock runs all
+// published operations on the structure in one pass, while the other
+// threads spin briefly on their slots and find their results ready. The
+// structure stays in the combiner's cache and the lock changes hands once
+// per batch instead of once per operation as with a plain mutex.
+// Threads whose slot is taken by another thread (more threads than slots)
+// run their operation directly under the combiner lock.
+//
+//   FlatCombining<priority_queue<int>> pq;
+//   pq.apply([](auto& q){ q.push(5); });
+//   int top = pq.apply([](auto& q){ int t = q.top(); q.pop(); return t; });
+
+template <typename Seq>
+class FlatCombining
+{
+public:
+	explicit FlatCombining(uint32_t num_slots = 0, Seq seq = Seq())
+		: seq_ {move(seq)}
+	{
+		if ( num_slots == 0 )  num_slots = 2 * max(1u, thread::hardware_concurrency());
+		num_slots = bit_ceil(num_slots);
+		slots_.reset(new Slot[num_slots]);
+		mask_ = num_slots - 1;
+	}
+
+	FlatCombining(const FlatCombining&) = delete;
+	FlatCombining& operator=(const FlatCombining&) = delete;
+
+	// Runs func(seq) exclusively and returns its result.
+	// Exceptions thrown by func are rethrown in the calling thread.
+	template <typename Function>
+	invoke_result_t<Function&, Seq&> apply(Function func)
+	{
+		using Result = invoke_result_t<Function&, Seq&>;
+		if constexpr ( is_void_v<Result> )
+			submit(func);
+		else
+		{
+			optional<Result> res;
+			auto call = [&func, &res](Seq& seq){ res.emplace(func(seq)); };
+			submit(call);
+			return move(*res);
+		}
+	}
+
+private:
+	struct Request
+	{
+		void (*run)(void* func, Seq& seq);
+		void* func;
+		exception_ptr error;
+		atomic<bool> done {false};
+	};
+
+	struct alignas(cache_line_size) Slot
+	{
+		atomic<Request*> request {nullptr};
+	};
+
+	template <typename Call>
+	void submit(Call& call)
+	{
+		Request req;
+		req.run = [](void* f, Seq& seq){ (*static_cast<Call*>(f))(seq); };
+		req.func = &call;
+		Slot& slot = slots_[threadIndex() & mask_];
+		Request* expected = nullptr;
+		if ( !slot.request.compare_exchange_strong(expected, &req, memory_order_release) )
+		{
+			lock_guard<mutex> lk(combiner_);		// Slot shared with a busy thread
+			call(seq_);
+			return;
+		}
+
+		Backoff backoff;
+		while ( !req.done.load(memory_order_acquire) )
+		{
+			if ( combiner_.try_lock() )
+			{
+				combine();							// Serves this request too
+				combiner_.unlock();
+			}
+			else if ( !backoff.spin() )
+				this_thread::yield();				// Combiner may be preempted
+		}
+		if ( req.error )  rethrow_exception(req.error);
+	}
+
+	void combine()
+	{
+		for ( uint32_t pass = 0; pass < combine_passes; ++pass )
+		{
+			bool found = false;
+			for ( uint32_t i = 0; i <= mask_; ++i )
+			{
+				Request* const r = slots_[i].request.load(memory_order_acquire);
+				if ( !r )  continue;
+				found = true;
+				try
+				{
+					r->run(r->func, seq_);
+				}
+				catch ( ... )
+				{
+					r->error = current_exception();
+				}
+				slots_[i].request.store(nullptr, memory_order_relaxed);
+				r->done.store(true, memory_order_release);	// r may be gone after this
+			}
+			if ( !found )  break;
+		}
+	}
+
+	static constexpr uint32_t combine_passes = 2;	// Late arrivals of the batch are caught too
+
+	Seq seq_;
+	mutex combiner_;
+	unique_ptr<Slot[]> slots_;
+	uint32_t mask_;
+};
@@ -0,0 +1,146 @@
+#include "flat_combining.h"
+#include "threadsafe_list.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+void testFlatCombining()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	FlatCombining<priority_queue<int>> pq;
+	for ( int i : {3, 9, 1, 7} )
+		pq.apply([i](auto& q){ q.push(i); });
+	const int top = pq.apply([](auto& q){ const int t = q.top(); q.pop(); return t; });
+	cout << top << '\n';
+	assert(top == 9);
+	assert(pq.apply([](auto& q){ return q.size(); }) == 3);
+
+	bool thrown = false;
+	try
+	{
+		pq.apply([](auto&) -> int { throw runtime_error("empty"); });
+	}
+	catch ( const runtime_error& )
+	{
+		thrown = true;
+	}
+	assert(thrown);
+
+	const uint32_t num_threads = 8, n = 10'000;		// More threads than slots share them
+	FlatCombining<vector<uint32_t>> v(2);
+	vector<thread> threads;
+	for ( uint32_t id = 0; id < num_threads; ++id )
+		threads.emplace_back([&v, id]()
+		{
+			for ( uint32_t i = 0; i < n; ++i )
+				v.apply([x = id * n + i](auto& vec){ vec.push_back(x); });
+		});
+	for ( auto& th : threads )  th.join();
+	v.apply([](auto& vec)
+	{
+		assert(vec.size() == num_threads * n);
+		sort(vec.begin(), vec.end());
+		for ( uint32_t i = 0; i < vec.size(); ++i )
+			assert(vec[i] == i);
+	});
+}
+
+
+
+// Sorted list of small ints: find, insert if absent, erase
+struct SortedList
+{
+	list<int> items;
+
+	bool find(int key) const
+	{
+		for ( int x : items )
+			if ( x >= key )  return x == key;
+		return false;
+	}
+
+	void insert(int key)
+	{
+		auto it = items.begin();
+		while ( it != items.end() && *it < key )  ++it;
+		if ( it == items.end() || *it != key )  items.insert(it, key);
+	}
+
+	void erase(int key) { items.remove(key); }
+};
+
+template <typename Operation>
+int64_t measure(uint32_t num_threads, uint32_t total_ops, Operation op)
+{
+	using namespace std::chrono;
+	auto t = steady_clock::now();
+	vector<thread> threads;
+	for ( uint32_t id = 0; id < num_threads; ++id )
+		threads.emplace_back([=]()
+		{
+			uint32_t x = id * 2654435761u + 1;
+			for ( uint32_t i = 0; i < total_ops / num_threads; ++i )
+			{
+				x ^= x << 13;  x ^= x >> 17;  x ^= x << 5;	// xorshift32
+				op(int(x % 256), x >> 24);
+			}
+		});
+	for ( auto& th : threads )  th.join();
+	return duration_cast<milliseconds>(steady_clock::now() - t).count();
+}
+
+void testFlatCombiningMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	const uint32_t total_ops = 100'000;
+	cout << "sorted list, 80% find, 10% insert, 10% erase\n";
+	cout << "threads  mutex  flat combining  TreadsafeList (ms)\n";
+	for ( uint32_t n = 1; n <= 16; n *= 2 )
+	{
+		SortedList locked;
+		mutex m;
+		FlatCombining<SortedList> fc;
+		TreadsafeList<int> tl;
+		for ( int k = 0; k < 256; k += 2 )
+		{
+			locked.insert(k);
+			fc.apply([k](SortedList& l){ l.insert(k); });
+			tl.pushFront(k);
+		}
+
+		cout << n << '\t' << measure(n, total_ops, [&](int key, uint32_t r)
+			{
+				lock_guard<mutex> lk(m);
+				if ( r < 205 )  locked.find(key);
+				else if ( r < 230 )  locked.insert(key);
+				else  locked.erase(key);
+			})
+			<< '\t' << measure(n, total_ops, [&](int key, uint32_t r)
+			{
+				fc.apply([key, r](SortedList& l)
+				{
+					if ( r < 205 )  l.find(key);
+					else if ( r < 230 )  l.insert(key);
+					else  l.erase(key);
+				});
+			})
+			<< "\t\t" << measure(n, total_ops, [&](int key, uint32_t r)
+			{
+				auto eq = [key](int x){ return x == key; };
+				if ( r < 205 )  tl.findFirstIf(eq);
+				else if ( r < 230 ) { if ( !tl.findFirstIf(eq) )  tl.pushFront(key); }
+				else  tl.removeIf(eq);
+			}) << '\n';
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+// HDR-style histogram of latencies in nanoseconds. Values are grouped by
+// their highest set bit, and every power-of-two range is split into
+// sub_bucket_count / 2 linear sub-buckets, so any recorded value is known to
+// within 1 / 64 of itself from 1 ns up to 2^64 ns with a fixed 30 KB array.
+// A histogram is not thread-safe: each thread records into its own and the
+// owner merges them when the threads are done.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+
+
+class LatencyHistogram
+{
+public:
+	static constexpr uint32_t sub_bucket_bits = 7;
+	static constexpr uint64_t sub_bucket_count = 1 << sub_bucket_bits;
+	static constexpr uint64_t sub_bucket_half = sub_bucket_count / 2;
+	static constexpr uint32_t num_buckets = 64 - sub_bucket_bits + 1;
+	static constexpr uint32_t num_counts = num_buckets * sub_bucket_half + sub_bucket_half;
+
+	void record(uint64_t value)
+	{
+		++counts_[indexOf(value)];
+		++total_;
+		sum_ += double(value);
+		min_ = std::min(min_, value);
+		max_ = std::max(max_, value);
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		for ( uint32_t i = 0; i < num_counts; ++i )
+			counts_[i] += other.counts_[i];
+		total_ += other.total_;
+		sum_ += other.sum_;
+		min_ = std::min(min_, other.min_);
+		max_ = std::max(max_, other.max_);
+	}
+
+	void reset() { *this = LatencyHistogram(); }
+
+	uint64_t count() const { return total_; }
+	uint64_t min() const { return total_ ? min_ : 0; }
+	uint64_t max() const { return max_; }
+	double mean() const { return total_ ? sum_ / total_ : 0.0; }
+
+	// Smallest value that at least q percent of the recorded values do not exceed
+	uint64_t percentile(double q) const
+	{
+		if ( total_ == 0 )  return 0;
+		const uint64_t target = std::max<uint64_t>(1, uint64_t(ceil(q / 100.0 * total_)));
+		uint64_t seen = 0;
+		for ( uint32_t i = 0; i < num_counts; ++i )
+			if ( (seen += counts_[i]) >= target )
+				return std::min(highestEquivalent(i), max_);
+		return max_;
+	}
+
+private:
+	static uint32_t indexOf(uint64_t value)
+	{
+		const uint32_t msb = 63 - countl_zero(value | (sub_bucket_count - 1));
+		const uint32_t bucket = msb - (sub_bucket_bits - 1);
+		return uint32_t(bucket * sub_bucket_half + (value >> bucket));
+	}
+
+	static uint64_t highestEquivalent(uint32_t index)
+	{
+		const uint32_t bucket = (index < sub_bucket_count ? 0 : index / sub_bucket_half - 1);
+		const uint64_t sub = index - bucket * sub_bucket_half;
+		return ((sub + 1) << bucket) - 1;
+	}
+
+	array<uint64_t, num_counts> counts_ {};
+	uint64_t total_ = 0;
+	double sum_ = 0.0;					// An integer sum would wrap for large values
+	uint64_t min_ = UINT64_MAX;
+	uint64_t max_ = 0;
+};
+
+
+
+inline void printPercentiles(const string& name, const LatencyHistogram& h)
+{
+	const ios_base::fmtflags flags = cout.flags();
+	cout << left << setw(20) << name << right;
+	for ( double q : {50.0, 90.0, 99.0, 99.9, 99.99} )
+		cout << setw(12) << h.percentile(q);
+	cout << setw(12) << h.max() << setw(12) << fixed << setprecision(1) << h.mean()
+		 << setw(12) << h.count() << '\n';
+	cout.flags(flags);
+}
+
+inline void printPercentileHeader()
+{
+	cout << left << setw(20) << "latency, ns" << right;
+	for ( const char* col : {"p50", "p90", "p99", "p99.9", "p99.99", "max", "mean", "count"} )
+		cout << setw(12) << col;
+	cout << '\n';
+}
@@ -0,0 +1,70 @@
+#include "latency_histogram.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+void testLatencyHistogram()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	LatencyHistogram h;
+	assert(h.count() == 0 && h.percentile(99) == 0);
+	for ( uint64_t v = 0; v < 128; ++v )			// Exact below sub_bucket_count
+		h.record(v);
+	assert(h.percentile(50) == 63);
+	assert(h.min() == 0 && h.max() == 127);
+
+	h.reset();
+	for ( uint64_t v = 1; v <= 1'000'000; ++v )
+		h.record(v);
+	printPercentileHeader();
+	printPercentiles("1..1000000", h);
+	for ( double q : {50.0, 90.0, 99.0, 99.9} )
+	{
+		const double exact = q / 100 * 1'000'000;
+		assert(h.percentile(q) >= exact && h.percentile(q) <= exact * (1 + 1.0 / 64));
+	}
+	assert(h.percentile(100) == 1'000'000);
+	assert(h.mean() == 500'000.5);
+
+	h.reset();
+	h.record(UINT64_MAX);
+	assert(h.percentile(50) == UINT64_MAX);
+	h.record(UINT64_MAX);
+	h.merge(h);
+	assert(h.count() == 4 && h.mean() == double(UINT64_MAX));
+}
+
+
+
+// Every thread records into its own histogram, the report merges them
+void testLatencyHistogramMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	const uint32_t num_threads = 4;
+	const uint64_t n = 100'000;
+	vector<LatencyHistogram> per_thread(num_threads);
+	vector<thread> threads;
+	for ( uint32_t id = 0; id < num_threads; ++id )
+		threads.emplace_back([&per_thread, id]()
+		{
+			for ( uint64_t i = 0; i < n; ++i )
+				per_thread[id].record((id + 1) * 1000);
+		});
+	for ( auto& th : threads )  th.join();
+
+	LatencyHistogram total;
+	for ( const LatencyHistogram& h : per_thread )
+		total.merge(h);
+	printPercentileHeader();
+	printPercentiles("merged", total);
+	assert(total.count() == num_threads * n);
+	assert(total.min() == 1000 && total.max() == 4000);
+	assert(total.percentile(25) >= 1000 && total.percentile(25) < 1016);
+	assert(total.percentile(50) >= 2000 && total.percentile(50) < 2032);
+	assert(total.percentile(100) == 4000);
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "cache_line.h"
+#include "wait_strategy.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+
+
+// Unbounded Michael-Scott queue. head_ always points to a dummy node, the
+// first real item lives in head_->next. Removed nodes are reclaimed the same
+// way LockFreeStack does it (lock_free_stack.cpp): they are chained into a
+// pending list which is deleted when only one thread is inside the queue.
+// Unlike the stack, enqueuers can still dereference a removed tail node, so
+// they are counted too.
+
+template <typename T>
+class LockFreeQueue
+{
+public:
+	LockFreeQueue();
+	~LockFreeQueue();
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	void push(const T& d);
+	shared_ptr<T> pop();
+	shared_ptr<T> waitPop() { return not_empty_.await([this](){ return pop(); }); }
+
+private:
+	struct Node
+	{
+		shared_ptr<T> data;
+		atomic<Node*> next {nullptr};
+		Node* pending_next {nullptr};		// Link in to_be_deleted_ list
+	};
+
+	static void deleteNodes(Node* nodes);
+	void tryReclaim(Node* old_head);
+	void chainPendingNodes(Node* nodes);
+	void chainPendingNodes(Node* first, Node* last);
+
+	alignas(cache_line_size) atomic<Node*> head_;
+	alignas(cache_line_size) atomic<Node*> tail_;
+	atomic<uint32_t> threads_in_ops_ {0};
+	atomic<Node*> to_be_deleted_ {nullptr};
+	EventCount not_empty_;
+};
+
+
+
+template <typename T>
+LockFreeQueue<T>::LockFreeQueue()
+{
+	Node* const dummy = new Node;
+	head_.store(dummy);
+	tail_.store(dummy);
+}
+
+
+
+template <typename T>
+LockFreeQueue<T>::~LockFreeQueue()
+{
+	while ( pop() ) ;
+	deleteNodes(to_be_deleted_.load());
+	delete head_.load();
+}
+
+
+
+template <typename T>
+void LockFreeQueue<T>::push(const T& d)
+{
+	Node* const new_node = new Node;
+	new_node->data = make_shared<T>(d);
+	++threads_in_ops_;
+	while ( true )
+	{
+		Node* tail = tail_.load(memory_order_acquire);
+		Node* next = tail->next.load(memory_order_acquire);
+		if ( tail != tail_.load(memory_order_acquire) )  continue;
+		if ( next )								// Tail is lagging, help to move it
+		{
+			tail_.compare_exchange_weak(tail, next, memory_order_release, memory_order_relaxed);
+			continue;
+		}
+		if ( tail->next.compare_exchange_weak(next, new_node,
+				memory_order_release, memory_order_relaxed) )
+		{
+			tail_.compare_exchange_strong(tail, new_node, memory_order_release, memory_order_relaxed);
+			break;
+		}
+	}
+	--threads_in_ops_;
+	not_empty_.notifyOne();
+}
+
+
+
+template <typename T>
+shared_ptr<T> LockFreeQueue<T>::pop()
+{
+	++threads_in_ops_;
+	while ( true )
+	{
+		Node* head = head_.load(memory_order_acquire);
+		Node* tail = tail_.load(memory_order_acquire);
+		Node* next = head->next.load(memory_order_acquire);
+		if ( head != head_.load(memory_order_acquire) )  continue;
+		if ( !next )							// Empty
+		{
+			--threads_in_ops_;
+			return shared_ptr<T>();
+		}
+		if ( head == tail )						// Tail is lagging, help to move it
+		{
+			tail_.compare_exchange_weak(tail, next, memory_order_release, memory_order_relaxed);
+			continue;
+		}
+		if ( head_.compare_exchange_weak(head, next, memory_order_acq_rel, memory_order_relaxed) )
+		{
+			shared_ptr<T> res;
+			res.swap(next->data);				// next becomes the new dummy
+			tryReclaim(head);
+			return res;
+		}
+	}
+}
+
+
+
+template <typename T>
+void LockFreeQueue<T>::deleteNodes(Node* nodes)
+{
+	while ( nodes )
+	{
+		Node* next = nodes->pending_next;
+		delete nodes;
+		nodes = next;
+	}
+}
+
+
+
+template <typename T>
+void LockFreeQueue<T>::tryReclaim(Node* old_head)
+{
+	if ( threads_in_ops_ == 1 )
+	{
+		Node* nodes_to_delete = to_be_deleted_.exchange(nullptr);
+		if ( --threads_in_ops_ == 0 )
+			deleteNodes(nodes_to_delete);
+		else if ( nodes_to_delete )
+			chainPendingNodes(nodes_to_delete);
+		delete old_head;
+	}
+	else  // Other threads may still look at old_head
+	{
+		chainPendingNodes(old_head, old_head);
+		--threads_in_ops_;
+	}
+}
+
+
+
+template <typename T>
+void LockFreeQueue<T>::chainPendingNodes(Node* nodes)
+{
+	Node* last = nodes;
+	while ( Node* const next = last->pending_next )  last = next;
+	chainPendingNodes(nodes, last);
+}
+
+
+
+template <typename T>
+void LockFreeQueue<T>::chainPendingNodes(Node* first, Node* last)
+{
+	last->pending_next = to_be_deleted_;
+	while ( !to_be_deleted_.compare_exchange_weak(last->pending_next, first) ) ;
+}
+
+
+
+// Multi-producer/single-consumer queue (D. Vyukov's intrusive MPSC queue).
+// Producers enqueue with a single atomic exchange on tail_ and then link the
+// previous node. Only the consumer touches head_ and frees nodes, so no
+// reclamation scheme is needed. Between the exchange and the link the new
+// item is not yet visible; pop() reports the queue as empty in that window.
+
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue() : head_ {new Node}, tail_ {head_} {}
+	~MpscQueue()
+	{
+		while ( pop() ) ;
+		delete head_;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	void push(const T& d)					// Any thread
+	{
+		Node* const new_node = new Node;
+		new_node->data = make_shared<T>(d);
+		Node* const prev = tail_.exchange(new_node, memory_order_acq_rel);
+		prev->next.store(new_node, memory_order_release);
+		not_empty_.notifyOne();
+	}
+
+	shared_ptr<T> pop()						// Consumer thread only
+	{
+		Node* const next = head_->next.load(memory_order_acquire);
+		if ( !next )  return shared_ptr<T>();
+		shared_ptr<T> res;
+		res.swap(next->data);
+		delete head_;
+		head_ = next;
+		return res;
+	}
+
+	shared_ptr<T> waitPop()					// Consumer thread only
+	{
+		return not_empty_.await([this](){ return pop(); });
+	}
+
+private:
+	struct Node
+	{
+		shared_ptr<T> data;
+		atomic<Node*> next {nullptr};
+	};
+
+	alignas(cache_line_size) Node* head_;	// Consumer-owned dummy
+	alignas(cache_line_size) atomic<Node*> tail_;
+	EventCount not_empty_;
+};
@@ -0,0 +1,123 @@
+#include "lock_free_queue.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+void testLockFreeQueue()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	LockFreeQueue<int> lfq;
+	assert(!lfq.pop());
+	lfq.push(100);
+	lfq.push(200);
+	lfq.push(300);
+	cout << *(lfq.pop()) << ' ';
+	cout << *(lfq.pop()) << ' ';
+	cout << *(lfq.pop()) << '\n';
+	assert(!lfq.pop());
+	lfq.push(400);
+	assert(*lfq.pop() == 400);
+
+	MpscQueue<int> mq;
+	assert(!mq.pop());
+	for ( int i : {1, 2, 3} )
+		mq.push(i);
+	for ( int i : {1, 2, 3} )
+		assert(*mq.pop() == i);
+	assert(!mq.pop());
+}
+
+
+
+void testLockFreeQueueMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	using namespace std::chrono;
+	constexpr uint32_t num_producers = 3;
+	constexpr uint32_t per_producer = 200'000;
+
+	// Many producers, many consumers: nothing lost, nothing duplicated
+	{
+		LockFreeQueue<uint32_t> q;
+		atomic<uint64_t> sum {0};
+		atomic<uint32_t> remaining {num_producers * per_producer};
+		auto t = steady_clock::now();
+		vector<thread> threads;
+		for ( uint32_t p = 0; p < num_producers; ++p )
+			threads.emplace_back([&]()
+			{
+				for ( uint32_t i = 1; i <= per_producer; ++i )
+					q.push(i);
+			});
+		for ( uint32_t c = 0; c < 2; ++c )
+			threads.emplace_back([&]()
+			{
+				while ( remaining.load(memory_order_relaxed) > 0 )
+					if ( shared_ptr<uint32_t> v = q.pop() )
+					{
+						sum += *v;
+						--remaining;
+					}
+			});
+		for ( auto& th : threads )  th.join();
+		auto dur = duration_cast<milliseconds>(steady_clock::now() - t).count();
+		cout << "LockFreeQueue: " << dur << " ms\n";
+		assert(sum == uint64_t(num_producers) * per_producer * (per_producer + 1) / 2);
+	}
+
+	// Many producers, single consumer: FIFO order is kept per producer
+	{
+		MpscQueue<pair<uint32_t, uint32_t>> q;
+		auto t = steady_clock::now();
+		vector<thread> producers;
+		for ( uint32_t p = 0; p < num_producers; ++p )
+			producers.emplace_back([&q, p]()
+			{
+				for ( uint32_t i = 1; i <= per_producer; ++i )
+					q.push({p, i});
+			});
+		uint32_t last[num_producers] = {};
+		for ( uint32_t received = 0; received < num_producers * per_producer; )
+			if ( auto v = q.pop() )
+			{
+				assert(v->second == last[v->first] + 1);
+				last[v->first] = v->second;
+				++received;
+			}
+		for ( auto& th : producers )  th.join();
+		auto dur = duration_cast<milliseconds>(steady_clock::now() - t).count();
+		cout << "MpscQueue: " << dur << " ms\n";
+	}
+
+	// Idle consumers sleep in waitPop() and wake up on push()
+	{
+		MpscQueue<steady_clock::time_point> q;
+		thread consumer([&q]()
+		{
+			for ( uint32_t i = 0; i < 3; ++i )
+			{
+				const auto pushed = *q.waitPop();
+				cout << "waitPop wake-up: "
+					 << duration_cast<microseconds>(steady_clock::now() - pushed).count() << " us\n";
+			}
+		});
+		for ( uint32_t i = 0; i < 3; ++i )
+		{
+			this_thread::sleep_for(milliseconds(5));
+			q.push(steady_clock::now());
+		}
+		consumer.join();
+
+		LockFreeQueue<uint32_t> lfq;
+		thread waiter([&lfq]() { assert(*lfq.waitPop() == 42); });
+		this_thread::sleep_for(milliseconds(5));
+		lfq.push(42);
+		waiter.join();
+	}
+}
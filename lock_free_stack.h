@@ -0,0 +1,135 @@
+#pragma once
+
+#include "wait_strategy.h"
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+
+
+template <typename T>
+class LockFreeStack
+{
+public:
+	LockFreeStack() = default;
+	~LockFreeStack()
+	{
+		deleteNodes(head_.load());
+		deleteNodes(to_be_deleted_.load());
+	}
+
+	LockFreeStack(const LockFreeStack&) = delete;
+	LockFreeStack& operator=(const LockFreeStack&) = delete;
+
+	void push(const T& d);
+	shared_ptr<T> pop();
+	shared_ptr<T> waitPop();
+
+private:
+	struct Node
+	{
+		shared_ptr<T> data;
+		Node* next;
+		Node(const T& d) : data {make_shared<T>(d)} {}
+	};
+
+	static void deleteNodes(Node* nodes);
+	void tryReclaim(Node* old_head);
+	void chainPendingNodes(Node* nodes);
+	void chainPendingNodes(Node* first, Node* last);
+	void chainPendingNode(Node* n);
+
+	atomic<Node*> head_;
+	atomic<uint32_t> threads_in_pop_;
+	atomic<Node*> to_be_deleted_;
+	EventCount not_empty_;
+};
+
+
+
+template <typename T>
+void LockFreeStack<T>::push(const T& d)
+{
+	Node* const new_node = new Node(d);
+	new_node->next = head_.load();
+	while ( !head_.compare_exchange_weak(new_node->next, new_node) ) ;
+	not_empty_.notifyOne();
+}
+
+
+
+template <typename T>
+shared_ptr<T> LockFreeStack<T>::pop()
+{
+	++threads_in_pop_;
+	Node* old_head = head_.load();
+	while ( old_head &&
+		!head_.compare_exchange_weak(old_head, old_head->next) ) ;
+	shared_ptr<T> res;
+	if ( old_head )  res.swap(old_head->data);
+	tryReclaim(old_head);
+	return res;
+}
+
+
+
+template <typename T>
+shared_ptr<T> LockFreeStack<T>::waitPop()
+{
+	return not_empty_.await([this](){ return pop(); });
+}
+
+
+
+template <typename T>
+void LockFreeStack<T>::deleteNodes(Node* nodes)
+{
+	while ( nodes )
+	{
+		Node* next = nodes->next;
+		delete nodes;
+		nodes = next;
+	}
+}
+
+
+
+template <typename T>
+void LockFreeStack<T>::tryReclaim(Node* old_head)
+{
+	if ( threads_in_pop_ == 1 )
+	{
+		Node* nodes_to_delete = to_be_deleted_.exchange(nullptr);
+		if ( --threads_in_pop_ == 0 )
+			deleteNodes(nodes_to_delete);
+		else if ( nodes_to_delete )
+			chainPendingNodes(nodes_to_delete);
+		delete old_head;
+	}
+	else  // At least two threads in pop()
+	{
+		if ( old_head )					// Nothing to chain after a pop from an empty stack
+			chainPendingNodes(old_head, old_head);
+		--threads_in_pop_;
+	}
+}
+
+
+
+template <typename T>
+void LockFreeStack<T>::chainPendingNodes(Node* nodes)
+{
+	Node* last = nodes;
+	while ( Node* const next = last->next )  last = next;
+	chainPendingNodes(nodes, last);
+}
+
+
+
+template <typename T>
+void LockFreeStack<T>::chainPendingNodes(Node* first, Node* last)
+{
+	last->next = to_be_deleted_;
+	while ( !to_be_deleted_.compare_exchange_weak(last->next, first) ) ;
+}
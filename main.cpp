@@ -1,6 +1,29 @@
 void testThreadsafeMap();
 void testThreadsafeMapMultithread();
+void testThreadsafeMapIntegral();
 void testTreadsafeList();
+void testAtomicSharedPtr();
+void testAtomicSharedPtrMultithread();
+void testMpmcQueue();
+void testMpmcQueueMultithread();
+void testSpscQueue();
+void testSpscQueueMultithread();
+void testLockFreeQueue();
+void testLockFreeQueueMultithread();
+void testChaseLevDeque();
+void testChaseLevDequeMultithread();
+void testThreadPool();
+void testThreadPoolForkJoin();
+void testSeqlockAtomic();
+void testSeqlockAtomicMultithread();
+void testStripedCounter();
+void testStripedCounterMultithread();
+void testLatencyHistogram();
+void testLatencyHistogramMultithread();
+void testMultiQueue();
+void testMultiQueueMultithread();
+void testFlatCombining();
+void testFlatCombiningMultithread();
 
 
 
@@ -8,7 +31,30 @@ int main()
 {
 	testThreadsafeMap();
 	testThreadsafeMapMultithread();
+	testThreadsafeMapIntegral();
 	testTreadsafeList();
+	testAtomicSharedPtr();
+	testAtomicSharedPtrMultithread();
+	testMpmcQueue();
+	testMpmcQueueMultithread();
+	testSpscQueue();
+	testSpscQueueMultithread();
+	testLockFreeQueue();
+	testLockFreeQueueMultithread();
+	testChaseLevDeque();
+	testChaseLevDequeMultithread();
+	testThreadPool();
+	testThreadPoolForkJoin();
+	testSeqlockAtomic();
+	testSeqlockAtomicMultithread();
+	testStripedCounter();
+	testStripedCounterMultithread();
+	testLatencyHistogram();
+	testLatencyHistogramMultithread();
+	testMultiQueue();
+	testMultiQueueMultithread();
+	testFlatCombining();
+	testFlatCombiningMultithread();
 }
 
-// g++ threadsafe_map_test.cpp threadsafe_list_test.cpp main.cpp -std=c++20 -Wall -Wextra -pthread -o zzz
+// g++ threadsafe_map_test.cpp threadsafe_list_test.cpp atomic_shared_ptr_test.cpp mpmc_queue_test.cpp spsc_queue_test.cpp lock_free_queue_test.cpp thread_pool_test.cpp seqlock_atomic_test.cpp striped_counter_test.cpp latency_histogram_test.cpp multi_queue_test.cpp flat_combining_test.cpp main.cpp -std=c++20 -Wall -Wextra -pthread -latomic -o zzz
@@ -1,3 +1,4 @@
+#include "wait_strategy.h"
 #include <atomic>
 #include <cassert>
 #include <iostream>
@@ -16,22 +17,24 @@ atomic<int> z;
 void write_x()
 {
 	x.store(true, memory_order_seq_cst);
+	x.notify_all();
 }
 
 void write_y()
 {
 	y.store(true, memory_order_seq_cst);
+	y.notify_all();
 }
 
 void read_x_y()
 {
-	while ( !x.load(memory_order_seq_cst) ) ;
+	waitWhileEqual(x, false, memory_order_seq_cst);	// Spin, then sleep until notified
 	if ( y.load(memory_order_seq_cst) )  ++z;
 }
 
 void read_y_x()
 {
-	while ( !y.load(memory_order_seq_cst) ) ;
+	waitWhileEqual(y, false, memory_order_seq_cst);
 	if ( x.load(memory_order_seq_cst) )  ++z;
 }
 
@@ -93,6 +96,7 @@ void func1()
 	arr[3].store(40, memory_order_relaxed);
 //	sync1.store(true, memory_order_release);		// Release-acquire ordering by sync1
 	sync0.store(1, memory_order_release);			// Release-acquire ordering by sync
+	sync0.notify_all();
 }
 
 void func2()
@@ -101,13 +105,17 @@ void func2()
 //	sync2.store(true, memory_order_release);		// Release-acquire ordering by sync2
 	int expected = 1;								// Release-acquire ordering by sync
 	while ( !sync0.compare_exchange_strong(expected, 2, memory_order_acq_rel) )
+	{
+		sync0.wait(expected, memory_order_acquire);	// Sleep until func1 changes sync0
 		expected = 1;
+	}
+	sync0.notify_all();
 }
 
 void func3()
 {
 //	while ( !sync2.load(memory_order_acquire) ) ;		// Release-acquire ordering by sync2
-	while ( sync0.load(memory_order_acquire) < 2 ) ;	// Release-acquire ordering by sync
+	waitUntil(sync0, [](int v){ return v >= 2; }, memory_order_acquire);	// Release-acquire ordering by sync
 	cout << arr[0] << ' ' << arr[1] << ' '
 		 << arr[2] << ' ' << arr[3] << '\n';
 	assert(arr[0] == 10 && arr[1] == 20 &&
@@ -131,13 +139,12 @@ void create_x()				// Producer (publisher)
 	x->s = "Foo-bar";
 	// Publisher makes a pointer through which the consumer accesses information
 	px.store(x, memory_order_release);					// Release-consume ordering
+	px.notify_all();
 }
 
 void use_x()				// Consumer (subscriber)
 {
-	X* x;
-	while ( !(x = px.load(memory_order_consume)) )		// Release-consume ordering
-		this_thread::sleep_for(std::chrono::microseconds(1));
+	X* x = waitWhileEqual<X*>(px, nullptr, memory_order_consume);	// Release-consume ordering
 	cout << x->i << ' ' << x->s << '\n';
 	assert(x->i == 42 && x->s == "Foo-bar");
 }
@@ -146,6 +153,7 @@ void use_x()				// Consumer (subscriber)
 
 vector<int> queue_data;
 atomic<int> queue_count;
+atomic<bool> queue_filled;
 
 void populate_quiue()
 {
@@ -154,18 +162,20 @@ void populate_quiue()
 	for ( unsigned i = 0; i < number_of_items; ++i )
 		queue_data.push_back(i);
 	queue_count.store(number_of_items, memory_order_release);
+	queue_filled.store(true, memory_order_release);
+	queue_filled.notify_all();
 }
 
+// The queue is filled once: consumers park until it is, then take items
+// until it is empty.
 void consume_queue_items()
 {
+	waitWhileEqual(queue_filled, false, memory_order_acquire);
 	while ( true )
 	{
 		int item_index = queue_count.fetch_sub(1, memory_order_acquire);
 		if ( item_index <= 0 )
-		{
-			this_thread::sleep_for(std::chrono::milliseconds(5));
 			break;
-		}
 		else
 		{
 //			process_data(queue_data[item_index-1]);
@@ -0,0 +1,343 @@
+// g++ memory_orders_litmus.cpp -std=c++20 -O2 -Wall -Wextra -pthread -o zzz
+// ./zzz [iterations]
+
+// Litmus harness and cost benchmark for the orderings shown in memory_orders.cpp.
+// Part 1 runs each litmus pattern many times with pinned threads and prints
+// how often every outcome was observed. The outcome marked with * is the one
+// the memory model forbids for some orderings; each row says whether it is
+// forbidden or allowed for the ordering used. Part 2 measures ns/op of loads,
+// stores, RMW operations and fences under each memory_order.
+// GCC and Clang promote memory_order_consume to acquire, so its rows show
+// the cost and the outcomes of acquire.
+
+#include "cache_line.h"
+#include "wait_strategy.h"
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+using namespace std::chrono;
+
+
+
+void pinToCpu(uint32_t index)
+{
+	const uint32_t num_cpus = max(1u, thread::hardware_concurrency());
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(index % num_cpus, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+
+
+// Every litmus instance has its own pair of locations and its own start
+// flag. A barrier per batch brings the threads together, and the two threads
+// meet again at every instance, as litmus7 does. Otherwise one thread would
+// soon run ahead of the other and the racy outcomes would rarely show up.
+struct Instance
+{
+	atomic<int> x {0};
+	atomic<int> y {0};
+	atomic<atomic<int>*> p {nullptr};
+	atomic<uint32_t> arrived {0};
+	int r0 = 0;
+	int r1 = 0;
+};
+
+void rendezvous(Instance& s)
+{
+	static const uint32_t max_spins = (thread::hardware_concurrency() > 1 ? 1000 : 0);
+	s.arrived.fetch_add(1, memory_order_relaxed);
+	for ( uint32_t k = 0; s.arrived.load(memory_order_relaxed) < 2; ++k )
+		if ( k < max_spins )
+			cpuRelax();
+		else
+			this_thread::yield();				// The other thread shares this core
+}
+
+constexpr uint32_t batch_size = 1000;
+
+using Histogram = map<pair<int, int>, uint64_t>;
+
+template <typename Thread0, typename Thread1>
+Histogram runLitmus(uint64_t iterations, Thread0 t0, Thread1 t1)
+{
+	unique_ptr<Instance[]> inst(new Instance[batch_size]);
+	Histogram hist;
+	const uint64_t num_batches = (iterations + batch_size - 1) / batch_size;
+	barrier sync(2);
+
+	auto body = [&](uint32_t id, auto&& func)
+	{
+		pinToCpu(id);
+		for ( uint64_t b = 0; b < num_batches; ++b )
+		{
+			sync.arrive_and_wait();			// Start the batch together
+			for ( uint32_t i = 0; i < batch_size; ++i )
+			{
+				rendezvous(inst[i]);
+				func(inst[i]);
+			}
+			sync.arrive_and_wait();			// Both are done, thread 0 collects
+			if ( id == 0 )
+				for ( uint32_t i = 0; i < batch_size; ++i )
+				{
+					++hist[{inst[i].r0, inst[i].r1}];
+					inst[i].x.store(0, memory_order_relaxed);
+					inst[i].y.store(0, memory_order_relaxed);
+					inst[i].p.store(nullptr, memory_order_relaxed);
+					inst[i].arrived.store(0, memory_order_relaxed);
+				}
+		}
+	};
+
+	thread a(body, 0, t0);
+	thread b(body, 1, t1);
+	a.join();
+	b.join();
+	return hist;
+}
+
+void printHistogram(const string& name, const Histogram& hist, pair<int, int> interesting, bool forbidden)
+{
+	cout << left << setw(34) << name;
+	for ( const auto& [outcome, count] : hist )
+		cout << "  (" << outcome.first << ',' << outcome.second << "): "
+			 << setw(9) << count << (outcome == interesting ? "*" : " ");
+	cout << "  * " << (forbidden ? "forbidden" : "allowed") << '\n';
+}
+
+
+
+constexpr bool isRelease(memory_order order)
+{
+	return order == memory_order_release || order == memory_order_acq_rel || order == memory_order_seq_cst;
+}
+
+// Consume orders only loads that depend on the value read, not the plain
+// loads of message passing, so it does not count here
+constexpr bool isAcquire(memory_order order)
+{
+	return order == memory_order_acquire || order == memory_order_acq_rel || order == memory_order_seq_cst;
+}
+
+
+
+// Store buffering (write_x/write_y + read_x_y/read_y_x): (0,0) is forbidden only by seq_cst
+template <memory_order store_order, memory_order load_order>
+void storeBuffering(const string& name, uint64_t iterations)
+{
+	auto hist = runLitmus(iterations,
+		[](Instance& s)
+		{
+			s.x.store(1, store_order);
+			s.r0 = s.y.load(load_order);
+		},
+		[](Instance& s)
+		{
+			s.y.store(1, store_order);
+			s.r1 = s.x.load(load_order);
+		});
+	printHistogram("SB " + name, hist, {0, 0},
+		store_order == memory_order_seq_cst && load_order == memory_order_seq_cst);
+}
+
+// Message passing (write_x_y_3/read_y_x_3): (1,0) is forbidden by release/acquire
+template <memory_order store_order, memory_order load_order, bool fences>
+void messagePassing(const string& name, uint64_t iterations)
+{
+	auto hist = runLitmus(iterations,
+		[](Instance& s)
+		{
+			s.x.store(1, memory_order_relaxed);
+			if ( fences )  atomic_thread_fence(memory_order_release);
+			s.y.store(1, store_order);
+		},
+		[](Instance& s)
+		{
+			s.r0 = s.y.load(load_order);
+			if ( fences )  atomic_thread_fence(memory_order_acquire);
+			s.r1 = s.x.load(memory_order_relaxed);
+		});
+	printHistogram("MP " + name, hist, {1, 0}, fences || (isRelease(store_order) && isAcquire(load_order)));
+}
+
+// Message passing through a pointer (create_x/use_x): the second load goes
+// through the pointer read by the first, so release/consume forbids (1,0).
+// With a relaxed load the dependency keeps the order on real hardware, but
+// the memory model allows (1,0).
+template <memory_order load_order>
+void messagePassingDependency(const string& name, uint64_t iterations)
+{
+	auto hist = runLitmus(iterations,
+		[](Instance& s)
+		{
+			s.x.store(1, memory_order_relaxed);
+			s.p.store(&s.x, memory_order_release);
+		},
+		[](Instance& s)
+		{
+			atomic<int>* const q = s.p.load(load_order);
+			s.r0 = (q != nullptr);
+			s.r1 = (q ? q->load(memory_order_relaxed) : 0);
+		});
+	printHistogram("MP+dep " + name, hist, {1, 0}, load_order != memory_order_relaxed);
+}
+
+// Load buffering: (1,1) is allowed by relaxed only, and even then never seen
+// on x86 (loads are not reordered with later stores) and rarely on ARM
+template <memory_order order>
+void loadBuffering(const string& name, uint64_t iterations)
+{
+	auto hist = runLitmus(iterations,
+		[](Instance& s)
+		{
+			s.r0 = s.x.load(order);
+			s.y.store(1, order == memory_order_acquire ? memory_order_release : order);
+		},
+		[](Instance& s)
+		{
+			s.r1 = s.y.load(order);
+			s.x.store(1, order == memory_order_acquire ? memory_order_release : order);
+		});
+	printHistogram("LB " + name, hist, {1, 1}, order != memory_order_relaxed);
+}
+
+
+
+// Cost of a single operation. The same atomic is shared by all threads in
+// the contended case and private to each thread in the uncontended one.
+// Threads that only load would share the cache line without contending, so
+// for loads the contended case adds a thread that keeps storing to it.
+struct alignas(cache_line_size) PaddedAtomic
+{
+	atomic<uint64_t> value {0};
+};
+
+template <typename Operation>
+double nsPerOp(uint32_t num_threads, bool contended, bool writer, uint64_t ops_per_thread, Operation op)
+{
+	vector<PaddedAtomic> cells(num_threads);
+	atomic<uint64_t> sink {0};
+	atomic<bool> stop {false};
+	barrier sync(num_threads + (writer ? 1 : 0));
+	vector<double> ns(num_threads);
+	vector<thread> threads;
+	for ( uint32_t id = 0; id < num_threads; ++id )
+		threads.emplace_back([&, id]()
+		{
+			pinToCpu(id);
+			atomic<uint64_t>& a = cells[contended ? 0 : id].value;
+			uint64_t local = 0;
+			sync.arrive_and_wait();
+			const auto t = steady_clock::now();
+			for ( uint64_t i = 0; i < ops_per_thread; ++i )
+				local += op(a, i);
+			ns[id] = double(duration_cast<nanoseconds>(steady_clock::now() - t).count()) / ops_per_thread;
+			sink += local;							// Keep results alive
+		});
+	thread writer_thread;
+	if ( writer )
+		writer_thread = thread([&]()
+		{
+			pinToCpu(num_threads);
+			sync.arrive_and_wait();
+			for ( uint64_t i = 0; !stop.load(memory_order_relaxed); ++i )
+				cells[0].value.store(i, memory_order_relaxed);
+		});
+	for ( auto& th : threads )  th.join();
+	stop.store(true, memory_order_relaxed);
+	if ( writer )  writer_thread.join();
+	double sum = 0;
+	for ( double v : ns )  sum += v;
+	return sum / num_threads;
+}
+
+template <typename Operation>
+void costRow(const string& name, uint64_t ops, Operation op, bool load = false)
+{
+	const uint32_t num_threads = max(2u, thread::hardware_concurrency());
+	cout << left << setw(28) << name << right << fixed << setprecision(2)
+		 << setw(12) << nsPerOp(1, false, false, ops, op)
+		 << setw(12) << nsPerOp(num_threads, true, load, ops / num_threads, op) << '\n';
+}
+
+void costBenchmark(uint64_t ops)
+{
+	cout << "\n" << left << setw(28) << "operation" << right << setw(12) << "ns/op"
+		 << setw(12) << "contended" << '\n';
+	costRow("load relaxed", ops, [](atomic<uint64_t>& a, uint64_t)
+		{ return a.load(memory_order_relaxed); }, true);
+	costRow("load consume", ops, [](atomic<uint64_t>& a, uint64_t)
+		{ return a.load(memory_order_consume); }, true);
+	costRow("load acquire", ops, [](atomic<uint64_t>& a, uint64_t)
+		{ return a.load(memory_order_acquire); }, true);
+	costRow("load seq_cst", ops, [](atomic<uint64_t>& a, uint64_t)
+		{ return a.load(memory_order_seq_cst); }, true);
+	costRow("store relaxed", ops, [](atomic<uint64_t>& a, uint64_t i)
+		{ a.store(i, memory_order_relaxed); return 0; });
+	costRow("store release", ops, [](atomic<uint64_t>& a, uint64_t i)
+		{ a.store(i, memory_order_release); return 0; });
+	costRow("store seq_cst", ops, [](atomic<uint64_t>& a, uint64_t i)
+		{ a.store(i, memory_order_seq_cst); return 0; });
+	costRow("fetch_add relaxed", ops, [](atomic<uint64_t>& a, uint64_t)
+		{ return a.fetch_add(1, memory_order_relaxed); });
+	costRow("fetch_add acq_rel", ops, [](atomic<uint64_t>& a, uint64_t)
+		{ return a.fetch_add(1, memory_order_acq_rel); });
+	costRow("fetch_add seq_cst", ops, [](atomic<uint64_t>& a, uint64_t)
+		{ return a.fetch_add(1, memory_order_seq_cst); });
+	costRow("exchange acq_rel", ops, [](atomic<uint64_t>& a, uint64_t i)
+		{ return a.exchange(i, memory_order_acq_rel); });
+	costRow("compare_exchange acq_rel", ops, [](atomic<uint64_t>& a, uint64_t i)
+		{
+			uint64_t expected = a.load(memory_order_relaxed);
+			return uint64_t(a.compare_exchange_strong(expected, i, memory_order_acq_rel));
+		});
+	costRow("fence acquire", ops, [](atomic<uint64_t>&, uint64_t)
+		{ atomic_thread_fence(memory_order_acquire); return 0; });
+	costRow("fence release", ops, [](atomic<uint64_t>&, uint64_t)
+		{ atomic_thread_fence(memory_order_release); return 0; });
+	costRow("fence seq_cst", ops, [](atomic<uint64_t>&, uint64_t)
+		{ atomic_thread_fence(memory_order_seq_cst); return 0; });
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	const uint64_t iterations = (argc > 1 ? strtoull(argv[1], nullptr, 10) : 1'000'000);
+	cout << "Litmus outcomes (r0,r1) over " << iterations << " runs, * marks the weak outcome:\n"
+		 << "SB (0,0) is forbidden only by seq_cst, MP (1,0) by release/acquire or fences,\n"
+		 << "MP+dep (1,0) by release/consume, LB (1,1) by anything stronger than relaxed\n";
+
+	storeBuffering<memory_order_seq_cst, memory_order_seq_cst>("seq_cst", iterations);
+	storeBuffering<memory_order_release, memory_order_acquire>("release/acquire", iterations);
+	storeBuffering<memory_order_relaxed, memory_order_relaxed>("relaxed", iterations);
+
+	messagePassing<memory_order_release, memory_order_acquire, false>("release/acquire", iterations);
+	messagePassing<memory_order_relaxed, memory_order_relaxed, true>("relaxed + fences", iterations);
+	messagePassing<memory_order_release, memory_order_relaxed, false>("release/relaxed", iterations);
+	messagePassing<memory_order_relaxed, memory_order_acquire, false>("relaxed/acquire", iterations);
+	messagePassing<memory_order_relaxed, memory_order_relaxed, false>("relaxed", iterations);
+
+	messagePassingDependency<memory_order_consume>("release/consume", iterations);
+	messagePassingDependency<memory_order_relaxed>("release/relaxed", iterations);
+
+	loadBuffering<memory_order_acquire>("acquire/release", iterations);
+	loadBuffering<memory_order_relaxed>("relaxed", iterations);
+
+	costBenchmark(iterations * 10);
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "cache_line.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+
+
+// Bounded multi-producer/multi-consumer ring buffer (D. Vyukov's design).
+// Every slot carries a sequence number telling whose turn it is:
+// sequence == pos      -- slot is free for the producer claiming pos,
+// sequence == pos + 1  -- slot is full for the consumer claiming pos.
+// Unlike the one-shot queue_data/queue_count pair in memory_orders.cpp
+// it can be refilled while consumers run.
+
+template <typename T>
+class MpmcQueue
+{
+public:
+	explicit MpmcQueue(size_t capacity);
+
+	MpmcQueue(const MpmcQueue&) = delete;
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	size_t capacity() const { return mask_ + 1; }
+
+	bool tryPush(T value);
+	bool tryPop(T& value);
+	size_t tryPushBatch(const T* values, size_t count);		// Returns number of pushed items
+	size_t tryPopBatch(T* values, size_t max_count);		// Returns number of popped items
+
+private:
+	struct Slot
+	{
+		atomic<size_t> sequence;
+		T data;
+	};
+
+	size_t claim(atomic<size_t>& position, size_t turn, size_t max_count, size_t& first);
+
+	unique_ptr<Slot[]> slots_;
+	size_t mask_;
+	alignas(cache_line_size) atomic<size_t> enqueue_pos_ {0};	// Tail
+	alignas(cache_line_size) atomic<size_t> dequeue_pos_ {0};	// Head
+};
+
+
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_t capacity)
+{
+	size_t size = 2;
+	while ( size < capacity )  size <<= 1;	// Power of two, so index is pos & mask
+	slots_.reset(new Slot[size]);
+	mask_ = size - 1;
+	for ( size_t i = 0; i < size; ++i )
+		slots_[i].sequence.store(i, memory_order_relaxed);
+}
+
+
+
+// Reserves up to max_count consecutive slots whose sequence equals
+// pos + turn (turn is 0 for producers and 1 for consumers).
+// Returns the number of reserved slots starting at position first.
+template <typename T>
+size_t MpmcQueue<T>::claim(atomic<size_t>& position, size_t turn, size_t max_count, size_t& first)
+{
+	first = position.load(memory_order_relaxed);
+	while ( true )
+	{
+		size_t count = 0;
+		bool overtaken = false;
+		while ( count < max_count )
+		{
+			const size_t pos = first + count;
+			const size_t seq = slots_[pos & mask_].sequence.load(memory_order_acquire);
+			const intptr_t diff = intptr_t(seq) - intptr_t(pos + turn);
+			if ( diff != 0 )
+			{
+				overtaken = (diff > 0);				// Other thread already moved past pos
+				break;
+			}
+			++count;
+		}
+		if ( count == 0 )
+		{
+			if ( !overtaken )  return 0;			// Full (or empty for consumers)
+			first = position.load(memory_order_relaxed);
+		}
+		else if ( position.compare_exchange_weak(first, first + count, memory_order_relaxed) )
+			return count;
+	}
+}
+
+
+
+template <typename T>
+bool MpmcQueue<T>::tryPush(T value)
+{
+	size_t pos;
+	if ( claim(enqueue_pos_, 0, 1, pos) == 0 )  return false;
+	Slot& slot = slots_[pos & mask_];
+	slot.data = move(value);
+	slot.sequence.store(pos + 1, memory_order_release);
+	return true;
+}
+
+
+
+template <typename T>
+bool MpmcQueue<T>::tryPop(T& value)
+{
+	size_t pos;
+	if ( claim(dequeue_pos_, 1, 1, pos) == 0 )  return false;
+	Slot& slot = slots_[pos & mask_];
+	value = move(slot.data);
+	slot.sequence.store(pos + mask_ + 1, memory_order_release);	// Free for the next lap
+	return true;
+}
+
+
+
+template <typename T>
+size_t MpmcQueue<T>::tryPushBatch(const T* values, size_t count)
+{
+	size_t first;
+	count = claim(enqueue_pos_, 0, count, first);
+	for ( size_t i = 0; i < count; ++i )
+	{
+		Slot& slot = slots_[(first + i) & mask_];
+		slot.data = values[i];
+		slot.sequence.store(first + i + 1, memory_order_release);
+	}
+	return count;
+}
+
+
+
+template <typename T>
+size_t MpmcQueue<T>::tryPopBatch(T* values, size_t max_count)
+{
+	size_t first;
+	const size_t count = claim(dequeue_pos_, 1, max_count, first);
+	for ( size_t i = 0; i < count; ++i )
+	{
+		Slot& slot = slots_[(first + i) & mask_];
+		values[i] = move(slot.data);
+		slot.sequence.store(first + i + mask_ + 1, memory_order_release);
+	}
+	return count;
+}
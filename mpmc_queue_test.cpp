@@ -0,0 +1,128 @@
+#include "mpmc_queue.h"
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+void testMpmcQueue()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	MpmcQueue<int> q(5);
+	cout << "capacity " << q.capacity() << '\n';
+	assert(q.capacity() == 8);
+
+	int value = 0;
+	assert(!q.tryPop(value));
+	for ( int i = 0; i < 8; ++i )
+		assert(q.tryPush(i));
+	assert(!q.tryPush(8));					// Full
+	assert(q.tryPop(value) && value == 0);
+	assert(q.tryPush(8));					// Slot reused on the next lap
+
+	int batch[8];
+	const size_t popped = q.tryPopBatch(batch, 8);
+	for ( size_t i = 0; i < popped; ++i )
+		cout << batch[i] << ' ';
+	cout << '\n';
+	assert(popped == 8 && batch[0] == 1 && batch[7] == 8);
+
+	const int items[] = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
+	assert(q.tryPushBatch(items, 10) == 8);	// Only as many as fit
+	assert(q.tryPopBatch(batch, 3) == 3 && batch[2] == 30);
+	assert(q.tryPushBatch(items + 8, 2) == 2);
+	assert(q.tryPopBatch(batch, 8) == 7 && batch[0] == 40 && batch[6] == 100);
+}
+
+
+
+// Mutex + deque baseline with the same try-interface
+template <typename T>
+class LockedQueue
+{
+public:
+	bool tryPush(T value)
+	{
+		lock_guard<mutex> lk(m_);
+		data_.push_back(move(value));
+		return true;
+	}
+
+	bool tryPop(T& value)
+	{
+		lock_guard<mutex> lk(m_);
+		if ( data_.empty() )  return false;
+		value = move(data_.front());
+		data_.pop_front();
+		return true;
+	}
+
+private:
+	deque<T> data_;
+	mutex m_;
+};
+
+
+
+template <typename Queue>
+uint64_t transfer(Queue& q, uint32_t num_producers, uint32_t num_consumers, uint32_t per_producer)
+{
+	atomic<uint64_t> sum {0};
+	atomic<uint32_t> remaining {num_producers * per_producer};
+	vector<thread> threads;
+	for ( uint32_t p = 0; p < num_producers; ++p )
+		threads.emplace_back([&]()
+		{
+			for ( uint32_t i = 1; i <= per_producer; ++i )
+				while ( !q.tryPush(i) )  this_thread::yield();
+		});
+	for ( uint32_t c = 0; c < num_consumers; ++c )
+		threads.emplace_back([&]()
+		{
+			uint64_t local = 0;
+			uint32_t value;
+			while ( remaining.load(memory_order_relaxed) > 0 )
+				if ( q.tryPop(value) )
+				{
+					local += value;
+					remaining.fetch_sub(1, memory_order_relaxed);
+				}
+				else
+					this_thread::yield();
+			sum += local;
+		});
+	for ( auto& th : threads )  th.join();
+	return sum;
+}
+
+void testMpmcQueueMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	using namespace std::chrono;
+	constexpr uint32_t num_producers = 2;
+	constexpr uint32_t num_consumers = 2;
+	constexpr uint32_t per_producer = 1'000'000;
+	constexpr uint64_t expected = uint64_t(num_producers) * per_producer * (per_producer + 1) / 2;
+	constexpr uint64_t ops = 2ull * num_producers * per_producer;
+
+	MpmcQueue<uint32_t> mpmc(1024);
+	auto t = steady_clock::now();
+	uint64_t sum = transfer(mpmc, num_producers, num_consumers, per_producer);
+	auto dur = duration_cast<microseconds>(steady_clock::now() - t).count();
+	cout << "MpmcQueue:     " << dur / 1000 << " ms, " << ops / max<int64_t>(dur, 1) << " Mops/s\n";
+	assert(sum == expected);
+
+	LockedQueue<uint32_t> locked;
+	t = steady_clock::now();
+	sum = transfer(locked, num_producers, num_consumers, per_producer);
+	dur = duration_cast<microseconds>(steady_clock::now() - t).count();
+	cout << "mutex + deque: " << dur / 1000 << " ms, " << ops / max<int64_t>(dur, 1) << " Mops/s\n";
+	assert(sum == expected);
+}
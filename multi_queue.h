@@ -0,0 +1,196 @@
+#pragma once
+
+#include "cache_line.h"
+#include "seqlock_atomic.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+
+
+// Relaxed concurrent priority queue (Rihani, Sanders, Dementiev, "MultiQueues:
+// Simple Relaxed Concurrent Priority Queues"). c * num_threads binary heaps,
+// each behind its own mutex. push() goes to a random heap, tryPop() peeks at
+// the tops of two random heaps and removes the better one, so threads rarely
+// meet on a lock. The price is order: a pop may return an element that is
+// not the global minimum. With c >= 2 the expected rank of a popped element
+// among all queued ones is O(number of heaps), independent of the queue size
+// (Alistarh et al., "The power of choice in priority scheduling").
+// Mode::Strict locks all heaps and returns the exact minimum, for comparison.
+// The tops are published through SeqlockAtomic so peeking takes no lock,
+// hence T must be trivially copyable, e.g. a (priority, job index) pair.
+
+template <typename T, typename Compare = less<T>>
+class MultiQueue
+{
+	static_assert(is_trivially_copyable_v<T>, "MultiQueue requires a trivially copyable type");
+
+public:
+	enum class Mode { Relaxed, Strict };
+
+	explicit MultiQueue(uint32_t num_threads = 0, uint32_t c = 2, Mode mode = Mode::Relaxed,
+		const Compare& cmp = Compare())
+		: mode_ {mode}, cmp_ {cmp}
+	{
+		if ( num_threads == 0 )  num_threads = thread::hardware_concurrency();
+		num_heaps_ = max(1u, num_threads * c);
+		heaps_.reset(new Heap[num_heaps_]);
+	}
+
+	MultiQueue(const MultiQueue&) = delete;
+	MultiQueue& operator=(const MultiQueue&) = delete;
+
+	uint32_t numHeaps() const { return num_heaps_; }
+
+	void push(const T& value)
+	{
+		while ( true )
+		{
+			Heap& h = heaps_[randomIndex()];
+			unique_lock<mutex> lk(h.m, try_to_lock);
+			if ( !lk )  continue;					// Busy, another heap is as good
+			h.data.push_back(value);
+			push_heap(h.data.begin(), h.data.end(), heapOrder());
+			publishTop(h);
+			return;
+		}
+	}
+
+	// Removes an element close to the minimum, false only if every heap was empty
+	bool tryPop(T& value)
+	{
+		if ( mode_ == Mode::Strict || num_heaps_ == 1 )
+			return popStrict(value);
+		for ( uint32_t attempt = 0; attempt < 2 * num_heaps_; ++attempt )
+		{
+			const uint32_t i = randomIndex();
+			uint32_t j = randomIndex();
+			if ( j == i )  j = (i + 1) % num_heaps_;
+			const Top a = heaps_[i].top.load();
+			const Top b = heaps_[j].top.load();
+			if ( a.empty && b.empty )  continue;
+			Heap& h = heaps_[(b.empty || (!a.empty && !cmp_(b.value, a.value))) ? i : j];
+			unique_lock<mutex> lk(h.m, try_to_lock);
+			if ( lk && popLocked(h, value) )
+				return true;
+		}
+		return popAny(value);						// Mostly empty or contended, look everywhere
+	}
+
+private:
+	struct Top
+	{
+		T value;
+		bool empty;
+	};
+
+	struct alignas(cache_line_size) Heap
+	{
+		mutex m;
+		vector<T> data;
+		SeqlockAtomic<Top> top {Top {T {}, true}};	// Written under m only
+	};
+
+	auto heapOrder() const							// Makes std heaps keep the minimum on top
+	{
+		return [this](const T& a, const T& b){ return cmp_(b, a); };
+	}
+
+	void publishTop(Heap& h)
+	{
+		h.top.store(h.data.empty() ? Top {T {}, true} : Top {h.data.front(), false});
+	}
+
+	bool popLocked(Heap& h, T& value)
+	{
+		if ( h.data.empty() )  return false;
+		pop_heap(h.data.begin(), h.data.end(), heapOrder());
+		value = h.data.back();
+		h.data.pop_back();
+		publishTop(h);
+		return true;
+	}
+
+	bool popAny(T& value)
+	{
+		const uint32_t start = randomIndex();
+		for ( uint32_t k = 0; k < num_heaps_; ++k )
+		{
+			Heap& h = heaps_[(start + k) % num_heaps_];
+			lock_guard<mutex> lk(h.m);
+			if ( popLocked(h, value) )
+				return true;
+		}
+		return false;
+	}
+
+	bool popStrict(T& value)
+	{
+		vector<unique_lock<mutex>> locks;			// Always taken in index order
+		locks.reserve(num_heaps_);
+		Heap* best = nullptr;
+		for ( uint32_t k = 0; k < num_heaps_; ++k )
+		{
+			Heap& h = heaps_[k];
+			locks.emplace_back(h.m);
+			if ( !h.data.empty() && (!best || cmp_(h.data.front(), best->data.front())) )
+				best = &h;
+		}
+		return best && popLocked(*best, value);
+	}
+
+	uint32_t randomIndex() const
+	{
+		static thread_local uint64_t state = hash<thread::id>()(this_thread::get_id()) | 1;
+		state ^= state >> 12;						// xorshift64*
+		state ^= state << 25;
+		state ^= state >> 27;
+		return uint32_t(((state * 0x2545F4914F6CDD1Dull) >> 32) * num_heaps_ >> 32);
+	}
+
+	Mode mode_;
+	Compare cmp_;
+	uint32_t num_heaps_;
+	unique_ptr<Heap[]> heaps_;
+};
+
+
+
+// The baseline: std::priority_queue behind one mutex, same interface
+template <typename T, typename Compare = less<T>>
+class LockedPriorityQueue
+{
+public:
+	void push(const T& value)
+	{
+		lock_guard<mutex> lk(m_);
+		q_.push(value);
+	}
+
+	bool tryPop(T& value)
+	{
+		lock_guard<mutex> lk(m_);
+		if ( q_.empty() )  return false;
+		value = q_.top();
+		q_.pop();
+		return true;
+	}
+
+private:
+	struct Inverse
+	{
+		Compare cmp;
+		bool operator()(const T& a, const T& b) const { return cmp(b, a); }
+	};
+
+	mutex m_;
+	priority_queue<T, vector<T>, Inverse> q_;
+};
@@ -0,0 +1,107 @@
+#include "multi_queue.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+// Number of still queued elements smaller than each popped one, over 0..n-1
+template <typename Queue>
+pair<double, uint32_t> rankError(Queue& q, uint32_t n)
+{
+	vector<uint32_t> values(n);
+	iota(values.begin(), values.end(), 0);
+	shuffle(values.begin(), values.end(), mt19937(1));
+	for ( uint32_t v : values )  q.push(v);
+
+	vector<uint32_t> fenwick(n + 1);				// Counts of queued values
+	auto add = [&](uint32_t i, int d){ for ( ++i; i <= n; i += i & -i )  fenwick[i] += d; };
+	auto less_than = [&](uint32_t i){ uint32_t s = 0; for ( ; i > 0; i -= i & -i )  s += fenwick[i]; return s; };
+	for ( uint32_t v = 0; v < n; ++v )  add(v, 1);
+
+	uint64_t sum = 0;
+	uint32_t worst = 0;
+	for ( uint32_t v; q.tryPop(v); )
+	{
+		const uint32_t rank = less_than(v);
+		sum += rank;
+		worst = max(worst, rank);
+		add(v, -1);
+	}
+	return {double(sum) / n, worst};
+}
+
+void testMultiQueue()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	MultiQueue<int> strict(4, 2, MultiQueue<int>::Mode::Strict);
+	for ( int x : {5, 1, 4, 2, 3} )  strict.push(x);
+	int v = 0;
+	for ( int expected = 1; expected <= 5; ++expected )
+	{
+		assert(strict.tryPop(v));
+		assert(v == expected);
+	}
+	assert(!strict.tryPop(v));
+
+	MultiQueue<int, greater<int>> max_first(1, 1);	// A single heap is exact too
+	for ( int x : {5, 1, 4, 2, 3} )  max_first.push(x);
+	assert(max_first.tryPop(v) && v == 5);
+
+	const uint32_t n = 100'000;
+	MultiQueue<uint32_t> relaxed(4, 2);
+	uint32_t u = 0;
+	const auto [mean, worst] = rankError(relaxed, n);
+	cout << relaxed.numHeaps() << " heaps, rank error mean " << mean << ", max " << worst << '\n';
+	assert(mean <= 2 * relaxed.numHeaps());
+	assert(!relaxed.tryPop(u));
+
+	MultiQueue<uint32_t> exact(4, 2, MultiQueue<uint32_t>::Mode::Strict);
+	assert(rankError(exact, 1000).second == 0);
+}
+
+
+
+template <typename Queue>
+int64_t measure(Queue& q, uint32_t num_threads, uint32_t total_ops)
+{
+	using namespace std::chrono;
+	for ( uint32_t i = 0; i < 1000; ++i )  q.push(i * 7919 % 1000);
+	auto t = steady_clock::now();
+	vector<thread> threads;
+	for ( uint32_t id = 0; id < num_threads; ++id )
+		threads.emplace_back([&q, id, num_threads, total_ops]()
+		{
+			uint32_t v = id;
+			for ( uint32_t i = 0; i < total_ops / num_threads / 2; ++i )
+			{
+				q.push(v * 2654435761u % 100'000);	// Scheduler-like: take a job, enqueue one
+				q.tryPop(v);
+			}
+		});
+	for ( auto& th : threads )  th.join();
+	return duration_cast<milliseconds>(steady_clock::now() - t).count();
+}
+
+void testMultiQueueMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	const uint32_t total_ops = 200'000;
+	cout << "threads  locked heap  MultiQueue  strict MultiQueue (ms)\n";
+	for ( uint32_t n = 1; n <= 64; n *= 2 )
+	{
+		LockedPriorityQueue<uint32_t> locked;
+		MultiQueue<uint32_t> relaxed(n);
+		MultiQueue<uint32_t> strict(n, 2, MultiQueue<uint32_t>::Mode::Strict);
+		cout << n << '\t' << measure(locked, n, total_ops) << "\t\t"
+			 << measure(relaxed, n, total_ops) << "\t\t"
+			 << measure(strict, n, total_ops) << '\n';
+	}
+}
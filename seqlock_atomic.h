@@ -0,0 +1,88 @@
+#pragma once
+
+#include "cache_line.h"
+#include "wait_strategy.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+using namespace std;
+
+
+
+// Atomic wrapper for trivially copyable structs too big for a lock-free
+// atomic<T> (e.g. atomic<Bar> in atomic.cpp is not lock free and falls back
+// to libatomic's global lock table).
+// Single writer: store() makes the sequence odd, writes, makes it even again.
+// Readers never write shared memory: load() copies the value and retries
+// if the sequence was odd or changed meanwhile.
+// The payload is kept in relaxed atomic words so the concurrent copy is not
+// a data race in the C++ memory model.
+
+template <typename T>
+class SeqlockAtomic
+{
+	static_assert(is_trivially_copyable_v<T>, "SeqlockAtomic requires a trivially copyable type");
+
+public:
+	SeqlockAtomic() : SeqlockAtomic(T {}) {}
+	explicit SeqlockAtomic(const T& value) { writeWords(value); }
+
+	SeqlockAtomic(const SeqlockAtomic&) = delete;
+	SeqlockAtomic& operator=(const SeqlockAtomic&) = delete;
+
+	static constexpr bool is_always_lock_free = atomic<uint64_t>::is_always_lock_free;
+
+	T load() const
+	{
+		Backoff backoff;
+		while ( true )
+		{
+			const uint64_t s1 = seq_.load(memory_order_acquire);
+			if ( (s1 & 1) == 0 )				// No write in progress
+			{
+				T value = readWords();
+				atomic_thread_fence(memory_order_acquire);	// Words are read before the recheck
+				if ( seq_.load(memory_order_relaxed) == s1 )
+					return value;
+			}
+			if ( !backoff.spin() )  this_thread::yield();	// Writer may be preempted mid-store
+		}
+	}
+
+	void store(const T& value)				// Only one writer at a time
+	{
+		const uint64_t s = seq_.load(memory_order_relaxed);
+		seq_.store(s + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);	// Odd sequence is visible before the words
+		writeWords(value);
+		seq_.store(s + 2, memory_order_release);
+	}
+
+private:
+	static constexpr size_t num_words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	T readWords() const
+	{
+		uint64_t buf[num_words];
+		for ( size_t i = 0; i < num_words; ++i )
+			buf[i] = words_[i].load(memory_order_relaxed);
+		alignas(T) unsigned char bytes[sizeof(T)];	// T need not be default-constructible
+		memcpy(bytes, buf, sizeof(T));
+		return *launder(reinterpret_cast<T*>(bytes));
+	}
+
+	void writeWords(const T& value)
+	{
+		uint64_t buf[num_words] = {};
+		memcpy(buf, &value, sizeof(T));
+		for ( size_t i = 0; i < num_words; ++i )
+			words_[i].store(buf[i], memory_order_relaxed);
+	}
+
+	alignas(cache_line_size) atomic<uint64_t> seq_ {0};
+	atomic<uint64_t> words_[num_words];
+};
@@ -0,0 +1,94 @@
+#include "seqlock_atomic.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+struct Quote						// Same size as Bar in atomic.cpp
+{
+	char c;
+	int i;
+	double d;
+	char s[10];
+};
+
+struct Point						// Trivially copyable, not default-constructible
+{
+	Point(int x_, int y_) : x {x_}, y {y_} {}
+	int x, y;
+};
+
+
+
+void testSeqlockAtomic()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	SeqlockAtomic<Quote> sa;
+	cout << boolalpha << "sizeof(Quote) " << sizeof(Quote)
+		 << ", SeqlockAtomic lock free " << sa.is_always_lock_free
+		 << ", atomic<Quote> lock free " << atomic<Quote>().is_lock_free() << '\n';
+	assert(sa.load().i == 0);
+	sa.store(Quote {'a', 42, 3.5, "quote"});
+	const Quote q = sa.load();
+	assert(q.c == 'a' && q.i == 42 && q.d == 3.5 && string(q.s) == "quote");
+
+	SeqlockAtomic<Point> sp(Point {1, 2});
+	sp.store(Point {3, 4});
+	assert(sp.load().x == 3 && sp.load().y == 4);
+}
+
+
+
+// Writer publishes quotes whose fields are all derived from one counter,
+// so a torn read is detected by comparing them.
+template <typename Atomic>
+uint64_t publishQuotes(Atomic& a, uint32_t num_readers, uint32_t num_reads)
+{
+	atomic<uint32_t> readers_left {num_readers};
+	vector<thread> readers;
+	for ( uint32_t r = 0; r < num_readers; ++r )
+		readers.emplace_back([&]()
+		{
+			for ( uint32_t k = 0; k < num_reads; ++k )
+			{
+				const Quote q = a.load();
+				assert(q.d == double(q.i) && q.c == char(q.i));
+				(void)q;
+			}
+			--readers_left;
+		});
+
+	uint64_t writes = 0;
+	for ( int i = 0; readers_left.load(memory_order_relaxed) > 0; ++i, ++writes )
+	{
+		a.store(Quote {char(i), i, double(i), "tick"});
+		this_thread::yield();					// Give readers a fair share on small hosts
+	}
+	for ( auto& th : readers )  th.join();
+	return writes;
+}
+
+void testSeqlockAtomicMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	using namespace std::chrono;
+	constexpr uint32_t num_readers = 3;
+	constexpr uint32_t num_reads = 2'000'000;
+
+	SeqlockAtomic<Quote> sa;
+	auto t = steady_clock::now();
+	uint64_t writes = publishQuotes(sa, num_readers, num_reads);
+	auto dur = duration_cast<milliseconds>(steady_clock::now() - t).count();
+	cout << "SeqlockAtomic<Quote>: " << dur << " ms, " << writes << " writes\n";
+
+	atomic<Quote> aq;
+	t = steady_clock::now();
+	writes = publishQuotes(aq, num_readers, num_reads);
+	dur = duration_cast<milliseconds>(steady_clock::now() - t).count();
+	cout << "atomic<Quote>:        " << dur << " ms, " << writes << " writes\n";
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "cache_line.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <span>
+
+using namespace std;
+
+
+
+// Wait-free single-producer/single-consumer ring buffer.
+// Publication follows write_x_y_3/read_y_x_3 from memory_orders.cpp: the
+// producer writes the item (relaxed, plain store) and then releases the
+// write index, the consumer acquires the write index before reading the item.
+// Each side keeps a local copy of the other side's index and reloads it only
+// when the copy says the buffer is full (empty), so in the steady state the
+// producer and consumer cache lines are not bounced between cores.
+
+template <typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity);
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	size_t capacity() const { return mask_ + 1; }
+
+	// Producer side
+	bool tryPush(T value);
+	span<T> writeSpan(size_t max_count);	// Contiguous free slots, may be shorter than max_count
+	void commitWrite(size_t count);			// Publishes first count slots of writeSpan()
+
+	// Consumer side
+	bool tryPop(T& value);
+	span<T> readSpan(size_t max_count);		// Contiguous filled slots, may be shorter than max_count
+	void commitRead(size_t count);			// Frees first count slots of readSpan()
+
+private:
+	unique_ptr<T[]> data_;
+	size_t mask_;
+
+	alignas(cache_line_size) atomic<size_t> write_idx_ {0};
+	size_t cached_read_idx_ {0};			// Producer's copy of read_idx_
+
+	alignas(cache_line_size) atomic<size_t> read_idx_ {0};
+	size_t cached_write_idx_ {0};			// Consumer's copy of write_idx_
+};
+
+
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity)
+{
+	size_t size = 2;
+	while ( size < capacity )  size <<= 1;
+	data_.reset(new T[size]);
+	mask_ = size - 1;
+}
+
+
+
+template <typename T>
+bool SpscQueue<T>::tryPush(T value)
+{
+	const size_t w = write_idx_.load(memory_order_relaxed);	// Only we write it
+	if ( w - cached_read_idx_ > mask_ )
+	{
+		cached_read_idx_ = read_idx_.load(memory_order_acquire);
+		if ( w - cached_read_idx_ > mask_ )  return false;		// Full
+	}
+	data_[w & mask_] = move(value);
+	write_idx_.store(w + 1, memory_order_release);
+	return true;
+}
+
+
+
+template <typename T>
+span<T> SpscQueue<T>::writeSpan(size_t max_count)
+{
+	const size_t w = write_idx_.load(memory_order_relaxed);
+	size_t free = capacity() - (w - cached_read_idx_);
+	if ( free < max_count )
+	{
+		cached_read_idx_ = read_idx_.load(memory_order_acquire);
+		free = capacity() - (w - cached_read_idx_);
+	}
+	const size_t to_end = capacity() - (w & mask_);		// Do not wrap around
+	return span<T>(&data_[w & mask_], min({max_count, free, to_end}));
+}
+
+
+
+template <typename T>
+void SpscQueue<T>::commitWrite(size_t count)
+{
+	write_idx_.store(write_idx_.load(memory_order_relaxed) + count, memory_order_release);
+}
+
+
+
+template <typename T>
+bool SpscQueue<T>::tryPop(T& value)
+{
+	const size_t r = read_idx_.load(memory_order_relaxed);	// Only we write it
+	if ( r == cached_write_idx_ )
+	{
+		cached_write_idx_ = write_idx_.load(memory_order_acquire);
+		if ( r == cached_write_idx_ )  return false;			// Empty
+	}
+	value = move(data_[r & mask_]);
+	read_idx_.store(r + 1, memory_order_release);
+	return true;
+}
+
+
+
+template <typename T>
+span<T> SpscQueue<T>::readSpan(size_t max_count)
+{
+	const size_t r = read_idx_.load(memory_order_relaxed);
+	size_t filled = cached_write_idx_ - r;
+	if ( filled < max_count )
+	{
+		cached_write_idx_ = write_idx_.load(memory_order_acquire);
+		filled = cached_write_idx_ - r;
+	}
+	const size_t to_end = capacity() - (r & mask_);
+	return span<T>(&data_[r & mask_], min({max_count, filled, to_end}));
+}
+
+
+
+template <typename T>
+void SpscQueue<T>::commitRead(size_t count)
+{
+	read_idx_.store(read_idx_.load(memory_order_relaxed) + count, memory_order_release);
+}
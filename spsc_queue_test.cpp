@@ -0,0 +1,100 @@
+#include "spsc_queue.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+
+
+void testSpscQueue()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	SpscQueue<int> q(4);
+	int value = 0;
+	assert(!q.tryPop(value));
+	for ( int i = 1; i <= 3; ++i )
+		assert(q.tryPush(i));
+	assert(q.tryPop(value) && value == 1);
+
+	span<int> ws = q.writeSpan(4);			// Slots 3 and 0 are free, only 3 is contiguous
+	assert(ws.size() == 1);
+	ws[0] = 4;
+	q.commitWrite(1);
+	ws = q.writeSpan(4);
+	assert(ws.size() == 1);
+	ws[0] = 5;
+	q.commitWrite(1);
+	assert(!q.tryPush(6));					// Full
+
+	span<int> rs = q.readSpan(8);
+	for ( int v : rs )  cout << v << ' ';
+	assert(rs.size() == 3 && rs[0] == 2 && rs[2] == 4);
+	q.commitRead(rs.size());
+	rs = q.readSpan(8);
+	for ( int v : rs )  cout << v << ' ';
+	cout << '\n';
+	assert(rs.size() == 1 && rs[0] == 5);
+	q.commitRead(1);
+	assert(q.readSpan(8).empty());
+}
+
+
+
+void testSpscQueueMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	using namespace std::chrono;
+	constexpr uint64_t num_items = 10'000'000;
+	constexpr uint64_t expected = num_items * (num_items - 1) / 2;
+
+	{
+		SpscQueue<uint64_t> q(4096);
+		uint64_t sum = 0;
+		auto t = steady_clock::now();
+		thread consumer([&]()
+		{
+			uint64_t value;
+			for ( uint64_t i = 0; i < num_items; ++i )
+			{
+				while ( !q.tryPop(value) )  this_thread::yield();
+				sum += value;
+			}
+		});
+		for ( uint64_t i = 0; i < num_items; ++i )
+			while ( !q.tryPush(i) )  this_thread::yield();
+		consumer.join();
+		auto ns = duration_cast<nanoseconds>(steady_clock::now() - t).count();
+		cout << "tryPush/tryPop:       " << double(ns) / num_items << " ns/item\n";
+		assert(sum == expected);
+	}
+
+	{
+		SpscQueue<uint64_t> q(4096);
+		uint64_t sum = 0;
+		auto t = steady_clock::now();
+		thread consumer([&]()
+		{
+			for ( uint64_t done = 0; done < num_items; )
+			{
+				span<uint64_t> rs = q.readSpan(256);
+				if ( rs.empty() )  { this_thread::yield(); continue; }
+				for ( uint64_t v : rs )  sum += v;
+				q.commitRead(rs.size());
+				done += rs.size();
+			}
+		});
+		for ( uint64_t next = 0; next < num_items; )
+		{
+			span<uint64_t> ws = q.writeSpan(min<uint64_t>(256, num_items - next));
+			if ( ws.empty() )  { this_thread::yield(); continue; }
+			for ( uint64_t& v : ws )  v = next++;
+			q.commitWrite(ws.size());
+		}
+		consumer.join();
+		auto ns = duration_cast<nanoseconds>(steady_clock::now() - t).count();
+		cout << "writeSpan/readSpan:   " << double(ns) / num_items << " ns/item\n";
+		assert(sum == expected);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "cache_line.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <sched.h>
+
+using namespace std;
+
+
+
+// Counter split into cache-line-padded cells. Writers touch only their own
+// cell, so increments from different threads no longer bounce one cache line
+// between cores as a single atomic<int>::fetch_add does (z and queue_count in
+// memory_orders.cpp). read() sums all cells and is O(cells); the result is
+// exact once writers are quiet and a consistent approximation while they run.
+
+class StripedCounter
+{
+public:
+	enum class Striping { PerThread, PerCpu };
+
+	explicit StripedCounter(uint32_t num_cells = 0, Striping striping = Striping::PerThread)
+		: striping_ {striping}
+	{
+		if ( num_cells == 0 )  num_cells = thread::hardware_concurrency();
+		uint32_t size = 1;
+		while ( size < num_cells )  size <<= 1;
+		cells_.reset(new Cell[size]);
+		mask_ = size - 1;
+	}
+
+	StripedCounter(const StripedCounter&) = delete;
+	StripedCounter& operator=(const StripedCounter&) = delete;
+
+	void add(int64_t delta)
+	{
+		cells_[cellIndex()].value.fetch_add(delta, memory_order_relaxed);
+	}
+
+	void increment() { add(1); }
+
+	int64_t read() const
+	{
+		int64_t sum = 0;
+		for ( uint32_t i = 0; i <= mask_; ++i )
+			sum += cells_[i].value.load(memory_order_relaxed);
+		return sum;
+	}
+
+	// Approximate check for counters that only grow: stops summing as soon as
+	// the partial sum reaches the threshold, so hot limits are cheap to test.
+	bool reached(int64_t threshold) const
+	{
+		int64_t sum = 0;
+		for ( uint32_t i = 0; i <= mask_; ++i )
+			if ( (sum += cells_[i].value.load(memory_order_relaxed)) >= threshold )
+				return true;
+		return false;
+	}
+
+	void reset()
+	{
+		for ( uint32_t i = 0; i <= mask_; ++i )
+			cells_[i].value.store(0, memory_order_relaxed);
+	}
+
+private:
+	struct alignas(cache_line_size) Cell
+	{
+		atomic<int64_t> value {0};
+	};
+
+	uint32_t cellIndex() const
+	{
+		if ( striping_ == Striping::PerCpu )
+		{
+			const int cpu = sched_getcpu();			// Cheap vDSO call on Linux
+			if ( cpu >= 0 )  return uint32_t(cpu) & mask_;
+		}
+		return threadIndex() & mask_;				// Threads get consecutive cells
+	}
+
+	unique_ptr<Cell[]> cells_;
+	uint32_t mask_;
+	Striping striping_;
+};
@@ -0,0 +1,73 @@
+#include "striped_counter.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+void testStripedCounter()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	StripedCounter sc(4);
+	sc.increment();
+	sc.add(41);
+	cout << sc.read() << '\n';
+	assert(sc.read() == 42);
+	assert(sc.reached(42) && !sc.reached(43));
+	sc.add(-2);
+	assert(sc.read() == 40);
+	sc.reset();
+	assert(sc.read() == 0);
+
+	StripedCounter per_cpu(0, StripedCounter::Striping::PerCpu);
+	per_cpu.add(5);
+	assert(per_cpu.read() == 5);
+}
+
+
+
+template <typename Function>
+int64_t measure(uint32_t num_threads, Function increment)
+{
+	using namespace std::chrono;
+	auto t = steady_clock::now();
+	vector<thread> threads;
+	for ( uint32_t i = 0; i < num_threads; ++i )
+		threads.emplace_back(increment);
+	for ( auto& th : threads )  th.join();
+	return duration_cast<milliseconds>(steady_clock::now() - t).count();
+}
+
+void testStripedCounterMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	constexpr uint32_t num_threads = 4;
+	constexpr uint32_t per_thread = 2'000'000;
+
+	atomic<int64_t> plain {0};
+	auto dur = measure(num_threads, [&plain]()
+	{
+		for ( uint32_t i = 0; i < per_thread; ++i )
+			plain.fetch_add(1, memory_order_relaxed);
+	});
+	cout << "atomic<int64_t>::fetch_add:  " << dur << " ms\n";
+	assert(plain == int64_t(num_threads) * per_thread);
+
+	for ( auto striping : {StripedCounter::Striping::PerThread, StripedCounter::Striping::PerCpu} )
+	{
+		StripedCounter sc(num_threads, striping);
+		dur = measure(num_threads, [&sc]()
+		{
+			for ( uint32_t i = 0; i < per_thread; ++i )
+				sc.increment();
+		});
+		cout << "StripedCounter "
+			 << (striping == StripedCounter::Striping::PerThread ? "per thread: " : "per CPU:    ")
+			 << dur << " ms\n";
+		assert(sc.read() == int64_t(num_threads) * per_thread);
+	}
+}
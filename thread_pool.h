@@ -0,0 +1,224 @@
+#pragma once
+
+#include "chase_lev_deque.h"
+#include "lock_free_queue.h"
+#include "wait_strategy.h"
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+
+
+// Fixed-size work-stealing executor. Every worker owns a ChaseLevDeque:
+// tasks spawned by a worker go to the bottom of its own deque and are popped
+// LIFO, idle workers steal FIFO from the top of other deques. Tasks coming
+// from outside the pool go through a shared LockFreeQueue. Idle workers park
+// on an EventCount instead of spinning.
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(uint32_t num_threads = max(1u, thread::hardware_concurrency()));
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t size() const { return uint32_t(deques_.size()); }	// Complete before any worker starts
+
+	template <typename Function>
+	future<invoke_result_t<Function>> submit(Function func);
+
+	// Calls func(i) for every i in [begin, end), in chunks of grain indices.
+	// The calling thread helps to run tasks until all chunks are done.
+	// If func throws, the chunks not started yet are skipped and the first
+	// exception is rethrown here once no task refers to func any more.
+	template <typename Function>
+	void parallelFor(size_t begin, size_t end, size_t grain, Function func);
+
+	// co_await pool.schedule() resumes the coroutine on a pool thread
+	auto schedule()
+	{
+		struct Awaiter
+		{
+			ThreadPool& pool;
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(coroutine_handle<> h) { pool.post([h](){ h.resume(); }); }
+			void await_resume() const noexcept {}
+		};
+		return Awaiter {*this};
+	}
+
+private:
+	using Task = function<void()>;
+
+	void post(Task task);
+	void enqueue(Task task);					// Without waking a worker
+	bool runOne();
+	void workerLoop(uint32_t index);
+
+	vector<unique_ptr<ChaseLevDeque<Task*>>> deques_;
+	LockFreeQueue<Task*> injection_queue_;
+	EventCount work_available_;
+	atomic<bool> stop_ {false};
+	vector<thread> workers_;
+
+	static inline thread_local ThreadPool* current_pool_ = nullptr;	// Pool of this worker thread
+	static inline thread_local uint32_t current_index_ = 0;
+};
+
+
+
+inline ThreadPool::ThreadPool(uint32_t num_threads)
+{
+	for ( uint32_t i = 0; i < num_threads; ++i )
+		deques_.emplace_back(new ChaseLevDeque<Task*>);
+	for ( uint32_t i = 0; i < num_threads; ++i )
+		workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+
+
+inline ThreadPool::~ThreadPool()
+{
+	stop_.store(true);
+	work_available_.notifyAll();
+	for ( auto& th : workers_ )  th.join();
+}
+
+
+
+inline void ThreadPool::post(Task task)
+{
+	enqueue(move(task));
+	work_available_.notifyOne();
+}
+
+
+
+inline void ThreadPool::enqueue(Task task)
+{
+	Task* const t = new Task(move(task));
+	if ( current_pool_ == this )
+		deques_[current_index_]->push(t);
+	else
+		injection_queue_.push(t);
+}
+
+
+
+// Runs one task: own deque first, then the injection queue, then steals
+inline bool ThreadPool::runOne()
+{
+	Task* task = nullptr;
+	const bool is_worker = (current_pool_ == this);
+	bool found = is_worker && deques_[current_index_]->tryPop(task);
+	if ( !found )
+		if ( shared_ptr<Task*> t = injection_queue_.pop() )
+		{
+			task = *t;
+			found = true;
+		}
+	const uint32_t n = size();
+	const uint32_t start = is_worker ? current_index_ + 1 : 0;
+	for ( uint32_t i = 0; !found && i < n; ++i )
+		found = deques_[(start + i) % n]->trySteal(task);
+	if ( !found )  return false;
+	(*task)();
+	delete task;
+	return true;
+}
+
+
+
+inline void ThreadPool::workerLoop(uint32_t index)
+{
+	current_pool_ = this;
+	current_index_ = index;
+	Backoff backoff;
+	while ( true )
+	{
+		if ( runOne() )
+		{
+			backoff.reset();
+			continue;
+		}
+		if ( backoff.spin() )  continue;
+
+		const uint32_t key = work_available_.prepareWait();
+		if ( runOne() )
+		{
+			work_available_.cancelWait();
+			backoff.reset();
+		}
+		else if ( stop_.load() )
+		{
+			work_available_.cancelWait();
+			return;									// Nothing left to run
+		}
+		else
+			work_available_.wait(key);
+	}
+}
+
+
+
+template <typename Function>
+future<invoke_result_t<Function>> ThreadPool::submit(Function func)
+{
+	using Result = invoke_result_t<Function>;
+	auto task = make_shared<packaged_task<Result()>>(move(func));
+	future<Result> res = task->get_future();
+	post([task](){ (*task)(); });
+	return res;
+}
+
+
+
+template <typename Function>
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, Function func)
+{
+	if ( begin >= end )  return;
+	grain = max<size_t>(grain, 1);
+	const size_t num_chunks = (end - begin + grain - 1) / grain;
+	atomic<size_t> chunks_left {num_chunks};
+	atomic<bool> failed {false};
+	exception_ptr error;
+
+	for ( size_t c = 0; c < num_chunks; ++c )
+	{
+		const size_t first = begin + c * grain;
+		const size_t last = min(end, first + grain);
+		enqueue([&func, &chunks_left, &failed, &error, first, last]()
+		{
+			try
+			{
+				for ( size_t i = first; i < last && !failed.load(memory_order_relaxed); ++i )
+					func(i);
+			}
+			catch ( ... )
+			{
+				if ( !failed.exchange(true) )
+					error = current_exception();
+			}
+			chunks_left.fetch_sub(1, memory_order_release);	// Always, the caller waits for it
+		});
+	}
+	work_available_.notifyMany(uint32_t(min<size_t>(num_chunks, size())));	// One wake-up for all chunks
+
+	Backoff backoff;
+	while ( chunks_left.load(memory_order_acquire) > 0 )
+		if ( !runOne() && !backoff.spin() )
+			this_thread::yield();				// Remaining chunks are running elsewhere
+	if ( error )
+		rethrow_exception(error);
+}
@@ -0,0 +1,195 @@
+#include "thread_pool.h"
+#include <cassert>
+#include <chrono>
+#include <coroutine>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+// Minimal eagerly started coroutine, enough to exercise schedule()
+struct Detached
+{
+	struct promise_type
+	{
+		Detached get_return_object() { return {}; }
+		suspend_never initial_suspend() noexcept { return {}; }
+		suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { terminate(); }
+	};
+};
+
+Detached runOnPool(ThreadPool& pool, promise<thread::id>& done)
+{
+	co_await pool.schedule();
+	done.set_value(this_thread::get_id());
+}
+
+
+
+void testThreadPool()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	ThreadPool pool(3);
+	cout << "workers " << pool.size() << '\n';
+
+	future<int> f = pool.submit([](){ return 6 * 7; });
+	cout << f.get() << ' ';
+
+	vector<int> v(1000);
+	pool.parallelFor(0, v.size(), 64, [&v](size_t i){ v[i] = int(i); });
+	const int sum = accumulate(v.begin(), v.end(), 0);
+	cout << sum << '\n';
+	assert(sum == 999 * 1000 / 2);
+
+	// Nested parallelFor from inside a worker: tasks go to the worker's own deque
+	future<long> nested = pool.submit([&pool]()
+	{
+		atomic<long> s {0};
+		pool.parallelFor(1, 101, 10, [&s](size_t i){ s += long(i); });
+		return s.load();
+	});
+	assert(nested.get() == 5050);
+
+	// An exception in one chunk reaches the caller, the pool keeps working
+	bool thrown = false;
+	try
+	{
+		pool.parallelFor(0, 1000, 10, [](size_t i){ if ( i == 537 )  throw runtime_error("chunk"); });
+	}
+	catch ( const runtime_error& )
+	{
+		thrown = true;
+	}
+	assert(thrown);
+	assert(pool.submit([](){ return 1; }).get() == 1);
+
+	promise<thread::id> done;
+	runOnPool(pool, done);
+	assert(done.get_future().get() != this_thread::get_id());
+}
+
+
+
+void testChaseLevDeque()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	ChaseLevDeque<int> d(2);
+	int v = 0;
+	assert(!d.tryPop(v) && !d.trySteal(v));
+	for ( int i = 1; i <= 5; ++i )			// Grows beyond initial capacity
+		d.push(i);
+	assert(d.trySteal(v) && v == 1);		// FIFO for thieves
+	assert(d.tryPop(v) && v == 5);			// LIFO for the owner
+	assert(d.trySteal(v) && v == 2);
+	assert(d.tryPop(v) && v == 4);
+	assert(d.tryPop(v) && v == 3);
+	assert(!d.tryPop(v) && d.empty());
+}
+
+
+
+// The owner pushes and pops while thieves steal; starting from two slots the
+// array grows many times under the thieves. Every item must be taken once.
+void testChaseLevDequeMultithread()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	const uint32_t num_thieves = 3;
+	const int n = 200'000;
+	ChaseLevDeque<int> d(2);
+	vector<atomic<uint8_t>> taken(n);
+	atomic<bool> done {false};
+	atomic<int> stolen {0};
+
+	vector<thread> thieves;
+	for ( uint32_t k = 0; k < num_thieves; ++k )
+		thieves.emplace_back([&]()
+		{
+			int v = 0;
+			while ( !done.load() || !d.empty() )
+				if ( d.trySteal(v) )
+				{
+					taken[v].fetch_add(1, memory_order_relaxed);
+					stolen.fetch_add(1, memory_order_relaxed);
+				}
+				else
+					this_thread::yield();
+		});
+
+	int v = 0, popped = 0;
+	for ( int i = 0; i < n; ++i )
+	{
+		d.push(i);
+		if ( i % 3 == 0 && d.tryPop(v) )
+		{
+			taken[v].fetch_add(1, memory_order_relaxed);
+			++popped;
+		}
+	}
+	while ( !d.empty() )						// A failed pop lost the last item to a thief
+		if ( d.tryPop(v) )
+		{
+			taken[v].fetch_add(1, memory_order_relaxed);
+			++popped;
+		}
+	done.store(true);
+	for ( auto& th : thieves )  th.join();
+
+	cout << "popped " << popped << ", stolen " << stolen.load() << '\n';
+	for ( int i = 0; i < n; ++i )
+		assert(taken[i].load() == 1);
+}
+
+
+
+void testThreadPoolForkJoin()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	using namespace std::chrono;
+	constexpr size_t num_items = 2'000'000;
+	constexpr size_t grain = 2'000;				// 1000 fine-grained tasks
+	vector<double> data(num_items, 1.0);
+
+	auto work = [&data](size_t first, size_t last)
+	{
+		double s = 0;
+		for ( size_t i = first; i < last; ++i )  s += data[i] * 0.5;
+		return s;
+	};
+
+	ThreadPool pool;
+	auto t = steady_clock::now();
+	vector<double> partial(num_items / grain);
+	pool.parallelFor(0, partial.size(), 1,
+		[&](size_t c){ partial[c] = work(c * grain, (c + 1) * grain); });
+	auto dur = duration_cast<microseconds>(steady_clock::now() - t).count();
+	double total = accumulate(partial.begin(), partial.end(), 0.0);
+	cout << "ThreadPool(" << pool.size() << ") parallelFor: " << dur << " us\n";
+	assert(total == num_items * 0.5);
+
+	t = steady_clock::now();
+	vector<future<double>> futures;
+	for ( size_t c = 0; c < num_items / grain; ++c )
+		futures.push_back(pool.submit([&work, c](){ return work(c * grain, (c + 1) * grain); }));
+	total = 0;
+	for ( auto& f : futures )  total += f.get();
+	dur = duration_cast<microseconds>(steady_clock::now() - t).count();
+	cout << "ThreadPool(" << pool.size() << ") submit:      " << dur << " us\n";
+	assert(total == num_items * 0.5);
+
+	t = steady_clock::now();
+	vector<thread> threads;
+	for ( size_t c = 0; c < num_items / grain; ++c )
+		threads.emplace_back([&, c](){ partial[c] = work(c * grain, (c + 1) * grain); });
+	for ( auto& th : threads )  th.join();
+	dur = duration_cast<microseconds>(steady_clock::now() - t).count();
+	total = accumulate(partial.begin(), partial.end(), 0.0);
+	cout << "thread per task:         " << dur << " us\n";
+	assert(total == num_items * 0.5);
+}
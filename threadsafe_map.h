@@ -1,8 +1,12 @@
+#include "cache_line.h"
 #include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <type_traits>
 #include <vector>
 
 using namespace std;
@@ -106,3 +110,128 @@ private:
 	vector<unique_ptr<Bucket<Key, Value>>> buckets_;
 	Hash hasher_;
 };
+
+
+
+// Bucket for integral keys: keys and values in two arrays, so the search
+// scans packed keys and no pair<Key, Value> padding is stored. The order of
+// entries is not kept, remove() moves the last entry into the hole.
+// The buckets lie in one array, so each gets its own cache lines: otherwise
+// a writer locking one bucket would slow down readers of its neighbours.
+
+template <typename Key, typename Value>
+class alignas(cache_line_size) IntegralBucket
+{
+public:
+	Value getValue(Key key, const Value& default_value) const
+	{
+		shared_lock<shared_mutex> lock(mutex_);
+		const size_t i = indexOf(key);
+		return (i == keys_.size() ? default_value : values_[i]);
+	}
+
+	void addOrUpdate(Key key, const Value& value)
+	{
+		unique_lock<shared_mutex> lock(mutex_);
+		const size_t i = indexOf(key);
+		if ( i == keys_.size() )
+		{
+			keys_.push_back(key);
+			values_.push_back(value);
+		}
+		else
+			values_[i] = value;
+	}
+
+	void remove(Key key)
+	{
+		unique_lock<shared_mutex> lock(mutex_);
+		const size_t i = indexOf(key);
+		if ( i == keys_.size() )  return;
+		keys_[i] = keys_.back();
+		values_[i] = move(values_.back());
+		keys_.pop_back();
+		values_.pop_back();
+	}
+
+private:
+	size_t indexOf(Key key) const
+	{
+		return size_t(std::find(keys_.begin(), keys_.end(), key) - keys_.begin());
+	}
+
+	vector<Key> keys_;
+	vector<Value> values_;
+	mutable shared_mutex mutex_;
+};
+
+
+
+// Map for integral keys. The bucket count is a power of two and the bucket
+// is picked by Fibonacci hashing: the key times 2^64 / golden ratio, top bits.
+// Unlike hash<int>, which is the identity, the multiplication spreads
+// sequential and strided keys over all buckets, and no division is needed.
+// NumBuckets fixes the bucket count at compile time; 0 takes it from the
+// constructor, rounded up to a power of two and capped at max_buckets.
+// ThreadsafeMap<int, ...> stays the generic map, this one is used by name.
+
+template <typename Key, typename Value, uint32_t NumBuckets = 0>
+class IntegralThreadsafeMap
+{
+	static_assert(is_integral_v<Key>, "IntegralThreadsafeMap requires an integral key");
+
+public:
+	static constexpr uint32_t max_buckets = uint32_t(1) << 24;	// 2 GB of 128-byte buckets
+
+	static_assert(NumBuckets == 0 || (has_single_bit(NumBuckets) && NumBuckets >= 2 && NumBuckets <= max_buckets),
+		"NumBuckets must be a power of two, at most max_buckets");
+
+	using key_type = Key;
+	using value_type = Value;
+
+	explicit IntegralThreadsafeMap(uint32_t num_buckets = (NumBuckets ? NumBuckets : 16))
+		: shift_ {shiftFor(NumBuckets ? NumBuckets : bit_ceil(clamp(num_buckets, 2u, max_buckets)))}
+		, buckets_ {new IntegralBucket<Key, Value>[uint64_t(1) << (64 - shift_)]}
+	{
+	}
+
+	IntegralThreadsafeMap(const IntegralThreadsafeMap& other) = delete;
+	IntegralThreadsafeMap& operator=(const IntegralThreadsafeMap& other) = delete;
+
+	uint32_t numBuckets() const { return uint32_t(uint64_t(1) << (64 - shift())); }
+
+	Value getValue(Key key, const Value& default_value) const
+	{
+		return getBucket(key).getValue(key, default_value);
+	}
+
+	void addOrUpdate(Key key, const Value& value)
+	{
+		getBucket(key).addOrUpdate(key, value);
+	}
+
+	void remove(Key key)
+	{
+		getBucket(key).remove(key);
+	}
+
+private:
+	static constexpr uint32_t shiftFor(uint32_t num_buckets) { return 64 - countr_zero(num_buckets); }
+
+	uint32_t shift() const
+	{
+		if constexpr ( NumBuckets != 0 )
+			return shiftFor(NumBuckets);			// Folded into the instruction
+		else
+			return shift_;
+	}
+
+	IntegralBucket<Key, Value>& getBucket(Key key) const
+	{
+		const uint64_t h = uint64_t(key) * 0x9E3779B97F4A7C15ull;
+		return buckets_[h >> shift()];
+	}
+
+	const uint32_t shift_;
+	unique_ptr<IntegralBucket<Key, Value>[]> buckets_;
+};
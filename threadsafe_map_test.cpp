@@ -1,6 +1,9 @@
 #include "threadsafe_map.h"
+#include "OpenMP/time_measurer.hpp"
 #include <cassert>
 #include <cmath>
+#include <string>
+#include <type_traits>
 #include <iostream>
 #include <thread>
 
@@ -69,21 +72,72 @@ void Baz(uint32_t n1, uint32_t n2)
 void testThreadsafeMapMultithread()
 {
 	cout << "\n---------- " << __func__ << " ----------\n";
-	using namespace std::chrono;
-
 	Foo(SIZE);
-	auto t = steady_clock::now();
-	Bar(0, SIZE/2);
-	Baz(SIZE/2, SIZE);
-	auto dur = steady_clock::now() - t;
-	cout << "1 thread: " << duration_cast<milliseconds>(dur).count() << " ms\n";
+	START_TIMER("1 thread: ")
+		Bar(0, SIZE/2);
+		Baz(SIZE/2, SIZE);
+	STOP_TIMER
 
 	Foo(SIZE);
-	t = steady_clock::now();
-	thread th1(Bar, 0, SIZE/2);
-	thread th2(Baz, SIZE/2, SIZE);
-	th1.join();
-	th2.join();
-	dur = steady_clock::now() - t;
-	cout << "2 threads: " << duration_cast<milliseconds>(dur).count() << " ms\n";
+	START_TIMER("2 threads: ")
+		thread th1(Bar, 0, SIZE/2);
+		thread th2(Baz, SIZE/2, SIZE);
+		th1.join();
+		th2.join();
+	STOP_TIMER
+}
+
+
+
+template <typename Map>
+void fillQueryErase(Map& m, uint32_t n, uint32_t stride)
+{
+	for ( uint32_t i = 0; i < n; ++i )
+		m.addOrUpdate(i * stride, i);
+	uint64_t sum = 0;
+	for ( uint32_t round = 0; round < 4; ++round )
+		for ( uint32_t i = 0; i < 2 * n; ++i )
+			sum += m.getValue(i * stride, 0);
+	for ( uint32_t i = 0; i < n; ++i )
+		m.remove(i * stride);
+	assert(sum == 4 * uint64_t(n) * (n - 1) / 2);
+}
+
+void testThreadsafeMapIntegral()
+{
+	cout << "\n---------- " << __func__ << " ----------\n";
+	static_assert(!is_base_of_v<IntegralThreadsafeMap<int, string>, ThreadsafeMap<int, string>>);
+	static_assert(alignof(IntegralBucket<int, string>) == cache_line_size);
+	IntegralThreadsafeMap<int, string> m(10);
+	assert(m.numBuckets() == 16);
+	for ( int i = -50; i < 50; ++i )
+		m.addOrUpdate(i, to_string(i));
+	m.addOrUpdate(7, "seven");
+	m.remove(-3);
+	assert(m.getValue(7, "") == "seven");
+	assert(m.getValue(-3, "none") == "none");
+	assert(m.getValue(-50, "") == "-50" && m.getValue(49, "") == "49");
+	assert(m.getValue(50, "none") == "none");
+
+	IntegralThreadsafeMap<uint64_t, double, 1024> fixed;
+	fixed.addOrUpdate(uint64_t(1) << 63, 1.5);
+	assert(fixed.numBuckets() == 1024 && fixed.getValue(uint64_t(1) << 63, 0) == 1.5);
+
+	const uint32_t n = 100'000;
+	for ( uint32_t stride : {1u, 1024u} )
+	{
+		cout << "stride " << stride << ":\n";
+		START_TIMER("  generic, 4093 buckets:            ")
+			ThreadsafeMap<uint32_t, uint32_t> generic(4093);
+			fillQueryErase(generic, n, stride);
+		STOP_TIMER
+		START_TIMER("  integral, 4096 buckets:           ")
+			IntegralThreadsafeMap<uint32_t, uint32_t> integral(4096);
+			fillQueryErase(integral, n, stride);
+		STOP_TIMER
+		START_TIMER("  integral, constexpr 4096 buckets: ")
+			IntegralThreadsafeMap<uint32_t, uint32_t, 4096> integral;
+			fillQueryErase(integral, n, stride);
+		STOP_TIMER
+	}
 }
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace std;
+
+
+
+// Spin-then-park waiting. A waiter first spins with exponentially growing
+// pauses (cheap when the wait is short and the other thread runs on another
+// core), then parks in atomic::wait, which is a futex on Linux and costs no
+// CPU while sleeping. Use instead of bare `while ( !x.load() ) ;` loops and
+// sleep_for() polling.
+
+
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+
+
+class Backoff
+{
+public:
+	// Returns false once the spin budget is spent and the caller should park
+	bool spin()
+	{
+		if ( spins_ > max_spins )  return false;
+		for ( uint32_t i = 0; i < spins_; ++i )  cpuRelax();
+		spins_ <<= 1;
+		return true;
+	}
+
+	void reset() { spins_ = 1; }
+
+private:
+	static constexpr uint32_t max_spins = 1024;	// About 10 us of pauses in total
+	uint32_t spins_ = 1;
+};
+
+
+
+// Blocks until pred(a.load(order)) is true and returns the satisfying value.
+// The thread changing `a` must call a.notify_one() or a.notify_all().
+template <typename T, typename Predicate>
+T waitUntil(const atomic<T>& a, Predicate pred, memory_order order = memory_order_seq_cst)
+{
+	Backoff backoff;
+	T value = a.load(order);
+	while ( !pred(value) )
+	{
+		if ( !backoff.spin() )
+			a.wait(value, order);			// Returns when a is no longer equal to value
+		value = a.load(order);
+	}
+	return value;
+}
+
+
+
+// Blocks while a.load(order) == old.
+template <typename T>
+T waitWhileEqual(const atomic<T>& a, T old, memory_order order = memory_order_seq_cst)
+{
+	return waitUntil(a, [old](T v){ return v != old; }, order);
+}
+
+
+
+// Event count: lets a thread sleep until some condition, checked by a
+// non-blocking try-function, may have become true. Notifiers skip the futex
+// syscall entirely when nobody is parked, so the fast path of push() pays
+// only a fence and a load.
+// A producer that publishes n items at once calls notifyMany(n) after the
+// batch: one check and one epoch bump for the whole batch, and at most n
+// wakes, or a single wake-all when no more than n threads are parked.
+//
+// Waiter:   key = prepareWait(); if ( tryAgain() ) cancelWait(); else wait(key);
+// Notifier: make the condition true; notifyOne(), notifyMany(n) or notifyAll();
+
+class EventCount
+{
+public:
+	uint32_t prepareWait()
+	{
+		waiters_.fetch_add(1, memory_order_seq_cst);
+		atomic_thread_fence(memory_order_seq_cst);	// Pairs with the fence in notify
+		return epoch_.load(memory_order_seq_cst);
+	}
+
+	void cancelWait() { waiters_.fetch_sub(1, memory_order_relaxed); }
+
+	void wait(uint32_t key)
+	{
+		epoch_.wait(key, memory_order_seq_cst);
+		waiters_.fetch_sub(1, memory_order_relaxed);
+	}
+
+	void notifyOne()
+	{
+		if ( hasWaiters() )
+		{
+			epoch_.fetch_add(1, memory_order_seq_cst);
+			epoch_.notify_one();
+		}
+	}
+
+	void notifyAll()
+	{
+		if ( hasWaiters() )
+		{
+			epoch_.fetch_add(1, memory_order_seq_cst);
+			epoch_.notify_all();
+		}
+	}
+
+	// Wakes up to n waiters for n newly published items
+	void notifyMany(uint32_t n)
+	{
+		if ( n == 0 || !hasWaiters() )  return;
+		epoch_.fetch_add(1, memory_order_seq_cst);
+		if ( n >= waiters_.load(memory_order_relaxed) )
+			epoch_.notify_all();
+		else
+			for ( uint32_t i = 0; i < n; ++i )
+				epoch_.notify_one();
+	}
+
+	// Spins on try_fn with backoff, then parks until notified.
+	// try_fn returns something testable as bool (bool, pointer, shared_ptr).
+	template <typename Function>
+	auto await(Function try_fn)
+	{
+		Backoff backoff;
+		do
+		{
+			if ( auto res = try_fn() )  return res;
+		} while ( backoff.spin() );
+
+		while ( true )
+		{
+			const uint32_t key = prepareWait();
+			if ( auto res = try_fn() )
+			{
+				cancelWait();
+				return res;
+			}
+			wait(key);
+		}
+	}
+
+private:
+	bool hasWaiters()
+	{
+		atomic_thread_fence(memory_order_seq_cst);	// Publication of the condition before the check
+		return waiters_.load(memory_order_relaxed) != 0;
+	}
+
+	atomic<uint32_t> epoch_ {0};
+	atomic<uint32_t> waiters_ {0};
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+// Synthetic workload for the concurrent containers. Every thread draws an
+// operation (read, write or remove) according to the mix and a key from the
+// key space according to the distribution, and calls the matching method of
+// a container adapter:
+//
+//   struct Adapter
+//   {
+//       void prefill(uint64_t key);
+//       void read(uint64_t key);
+//       void write(uint64_t key);
+//       void remove(uint64_t key);
+//   };
+//
+// runWorkload() lets the threads run for a fixed time and counts operations.
+// With record_latency every operation is timed with steady_clock into a
+// per-thread LatencyHistogram, and the histograms are merged after the run.
+// With a rate the threads issue operations on a fixed schedule instead of
+// back to back. Then `latency` holds the service time of each operation and
+// `response` the time since it was due: a stalled operation delays all the
+// ones queued behind it, which a closed loop would silently not issue
+// (coordinated omission).
+
+#include "cache_line.h"
+#include "latency_histogram.h"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+enum class KeyDistribution { Uniform, Zipfian, HotSet };
+
+struct Workload
+{
+	uint32_t read_percent = 80;
+	uint32_t write_percent = 15;		// Removes take the rest
+	uint64_t key_space = 10'000;		// At most max_key_space
+	KeyDistribution distribution = KeyDistribution::Uniform;
+	double zipf_theta = 0.99;			// Skew, 0 is uniform
+	double hot_fraction = 0.1;			// Part of the key space that is hot
+	double hot_probability = 0.9;		// Part of the accesses that go to it
+	double seconds = 0.5;				// Duration of one run
+	double prefill_fraction = 0.5;		// Part of the key space inserted before the run
+	bool record_latency = false;
+	double rate = 0.0;					// Operations per second per thread, 0 = closed loop
+
+	// runWorkload() shuffles a vector of the whole key space (8 bytes a key) and
+	// the Zipfian setup sums over it. Above 10^7 ops/s the schedule interval
+	// comes close to the resolution of the clock and the cost of reading it.
+	static constexpr uint64_t max_key_space = uint64_t(1) << 26;
+	static constexpr double min_rate = 1.0;
+	static constexpr double max_rate = 1e7;
+};
+
+enum class Operation { Read, Write, Remove };
+
+
+
+// Shared, read-only after construction. Each thread passes its own engine.
+class KeyChooser
+{
+public:
+	explicit KeyChooser(const Workload& w) : w_ {w}
+	{
+		if ( w_.distribution == KeyDistribution::Zipfian )
+		{
+			// Gray et al., "Quickly generating billion-record synthetic databases"
+			zetan_ = zeta(w_.key_space, w_.zipf_theta);
+			alpha_ = 1.0 / (1.0 - w_.zipf_theta);
+			eta_ = (1.0 - pow(2.0 / w_.key_space, 1.0 - w_.zipf_theta))
+				/ (1.0 - zeta(2, w_.zipf_theta) / zetan_);
+			half_pow_theta_ = 1.0 + pow(0.5, w_.zipf_theta);
+		}
+		hot_keys_ = max<uint64_t>(1, uint64_t(w_.hot_fraction * w_.key_space));
+	}
+
+	template <typename Engine>
+	uint64_t nextKey(Engine& engine) const
+	{
+		uniform_real_distribution<double> unit(0.0, 1.0);
+		switch ( w_.distribution )
+		{
+		case KeyDistribution::Uniform:
+			return uniform_int_distribution<uint64_t>(0, w_.key_space - 1)(engine);
+		case KeyDistribution::Zipfian:
+		{
+			const double u = unit(engine);
+			const double uz = u * zetan_;
+			if ( uz < 1.0 )  return 0;
+			if ( uz < half_pow_theta_ )  return 1;
+			const uint64_t k = uint64_t(w_.key_space * pow(eta_ * u - eta_ + 1.0, alpha_));
+			return min(k, w_.key_space - 1);
+		}
+		case KeyDistribution::HotSet:
+			if ( unit(engine) < w_.hot_probability || hot_keys_ == w_.key_space )
+				return uniform_int_distribution<uint64_t>(0, hot_keys_ - 1)(engine);
+			return uniform_int_distribution<uint64_t>(hot_keys_, w_.key_space - 1)(engine);
+		}
+		return 0;
+	}
+
+	template <typename Engine>
+	Operation nextOperation(Engine& engine) const
+	{
+		const uint32_t p = uniform_int_distribution<uint32_t>(0, 99)(engine);
+		if ( p < w_.read_percent )  return Operation::Read;
+		if ( p < w_.read_percent + w_.write_percent )  return Operation::Write;
+		return Operation::Remove;
+	}
+
+private:
+	static double zeta(uint64_t n, double theta)
+	{
+		double sum = 0.0;
+		for ( uint64_t i = 1; i <= n; ++i )
+			sum += 1.0 / pow(double(i), theta);
+		return sum;
+	}
+
+	Workload w_;
+	double zetan_ = 0.0, alpha_ = 0.0, eta_ = 0.0, half_pow_theta_ = 0.0;
+	uint64_t hot_keys_;
+};
+
+
+
+struct WorkloadResult
+{
+	uint32_t threads;
+	uint64_t ops;
+	double seconds;
+	LatencyHistogram latency;			// Filled with record_latency or a rate
+	LatencyHistogram response;			// Filled with a rate only
+
+	double opsPerSec() const { return ops / seconds; }
+};
+
+// Hot keys are the low ranks, the prefill goes in random order so that they
+// do not end up in one place of order-sensitive containers such as a list.
+template <typename Adapter>
+WorkloadResult runWorkload(Adapter& container, const Workload& w, uint32_t num_threads)
+{
+	vector<uint64_t> keys(w.key_space);
+	iota(keys.begin(), keys.end(), 0);
+	mt19937_64 engine(42);
+	shuffle(keys.begin(), keys.end(), engine);
+	keys.resize(uint64_t(w.prefill_fraction * w.key_space));
+	for ( uint64_t k : keys )
+		container.prefill(k);
+
+	using Clock = chrono::steady_clock;
+	struct alignas(cache_line_size) Count { uint64_t value = 0; };
+	const KeyChooser chooser(w);
+	const bool timed = w.record_latency || w.rate > 0;
+	const auto interval = chrono::duration_cast<Clock::duration>(
+		chrono::duration<double>(w.rate > 0 ? 1.0 / w.rate : 0.0));
+	vector<Count> ops(num_threads);
+	vector<LatencyHistogram> latency(timed ? num_threads : 0);
+	vector<LatencyHistogram> response(w.rate > 0 ? num_threads : 0);
+	atomic<bool> stop {false};
+	barrier sync(num_threads + 1);
+	vector<thread> threads;
+	for ( uint32_t id = 0; id < num_threads; ++id )
+		threads.emplace_back([&, id]()
+		{
+			mt19937_64 engine(id + 1);
+			uint64_t n = 0;
+			const uint32_t batch = (w.rate > 0 ? 1 : 64);
+			sync.arrive_and_wait();
+			const Clock::time_point start = Clock::now();
+			while ( !stop.load(memory_order_relaxed) )
+				for ( uint32_t i = 0; i < batch; ++i, ++n )		// Check the flag once per batch
+				{
+					const Operation op = chooser.nextOperation(engine);
+					const uint64_t key = chooser.nextKey(engine);
+					const Clock::time_point due = start + interval * int64_t(n);
+					while ( w.rate > 0 && Clock::now() < due && !stop.load(memory_order_relaxed) )
+					{
+						const auto left = due - Clock::now();
+						if ( left > chrono::microseconds(200) )		// Wake up in time and now and then for stop
+							this_thread::sleep_for(min<Clock::duration>(left - chrono::microseconds(100), chrono::milliseconds(1)));
+						else
+							this_thread::yield();
+					}
+					if ( w.rate > 0 && stop.load(memory_order_relaxed) )
+						break;								// The run ended before this operation was due
+					const Clock::time_point t0 = (timed ? Clock::now() : Clock::time_point());
+					if ( op == Operation::Read )
+						container.read(key);
+					else if ( op == Operation::Write )
+						container.write(key);
+					else
+						container.remove(key);
+					if ( timed )
+					{
+						const Clock::time_point t1 = Clock::now();
+						latency[id].record(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+						if ( w.rate > 0 )
+							response[id].record(chrono::duration_cast<chrono::nanoseconds>(t1 - due).count());
+					}
+				}
+			ops[id].value = n;
+		});
+
+	sync.arrive_and_wait();
+	const auto t = chrono::steady_clock::now();
+	this_thread::sleep_for(chrono::duration<double>(w.seconds));
+	stop.store(true, memory_order_relaxed);
+	for ( auto& th : threads )  th.join();
+	const double sec = chrono::duration<double>(chrono::steady_clock::now() - t).count();
+
+	WorkloadResult res {num_threads, 0, sec, {}, {}};
+	for ( const Count& c : ops )  res.ops += c.value;
+	for ( const LatencyHistogram& h : latency )  res.latency.merge(h);
+	for ( const LatencyHistogram& h : response )  res.response.merge(h);
+	return res;
+}